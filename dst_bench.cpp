@@ -0,0 +1,827 @@
+/*
+    This file is part of SACD.
+
+    SACD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SACD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+// Decodes DST frames repeatedly and reports the decoder throughput. The frames are read from a DSDIFF file or
+// from a stream of dumped DSTF chunks, or are encoded from a synthetic DSD signal when no file is given.
+// Every decoded frame is compared with the synthetic source, or for a file with its first decode, and any
+// difference fails the run.
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <stdio.h>
+#include <time.h>
+#include <getopt.h>
+#include "libdstdec/dst_decoder_mt.h"
+
+using namespace std;
+
+#define FRAMERATE 75
+#define DST_PTABLE_LEN 64
+
+struct DstStream
+{
+    string strName;
+    int nChannels;
+    int nSampleRate;
+    vector<vector<uint8_t>> arrFrames;
+    vector<vector<uint8_t>> arrDsd; // DSD of every frame: the synthetic source, or the first decode of a file
+};
+
+struct BitWriter
+{
+    vector<uint8_t> arrData;
+    size_t nBits = 0;
+
+    void put(uint32_t nValue, int nLength)
+    {
+        for (int i = nLength - 1; i >= 0; i--)
+        {
+            if ((nBits >> 3) >= arrData.size())
+            {
+                arrData.push_back(0);
+            }
+
+            if ((nValue >> i) & 1)
+            {
+                arrData[nBits >> 3] |= 0x80 >> (nBits & 7);
+            }
+
+            nBits++;
+        }
+    }
+};
+
+// Arithmetic encoder matching CACData (12 bit interval), one code bit per byte of arrBits
+struct ACEncoder
+{
+    vector<uint8_t> arrBits;
+    unsigned int nLow = 0;
+    unsigned int nRange = 4095;
+
+    ACEncoder()
+    {
+        arrBits.push_back(0);
+    }
+
+    void encode(int nBit, int nProb)
+    {
+        unsigned int nAP = ((nRange >> 8) | ((nRange >> 7) & 1)) * nProb;
+        unsigned int nH = nRange - nAP;
+
+        if (nBit == 0)
+        {
+            nLow += nH;
+            nRange = nAP;
+        }
+        else
+        {
+            nRange = nH;
+        }
+
+        if (nLow >= 4096)
+        {
+            nLow -= 4096;
+
+            size_t i = arrBits.size() - 1;
+
+            while (arrBits[i] == 1)
+            {
+                arrBits[i--] = 0;
+            }
+
+            arrBits[i] = 1;
+        }
+
+        while (nRange < 2048)
+        {
+            nRange <<= 1;
+            nLow <<= 1;
+            arrBits.push_back((nLow >> 12) & 1);
+            nLow &= 4095;
+        }
+    }
+
+    void flush()
+    {
+        for (int i = 11; i >= 0; i--)
+        {
+            arrBits.push_back((nLow >> i) & 1);
+        }
+    }
+};
+
+double getTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+uint64_t readBE(const uint8_t* pData, int nBytes)
+{
+    uint64_t nValue = 0;
+
+    for (int i = 0; i < nBytes; i++)
+    {
+        nValue = (nValue << 8) | pData[i];
+    }
+
+    return nValue;
+}
+
+// Collects the DSTF chunks of a DSDIFF file (FRM8/PROP/DST containers are descended) or of a bare chunk stream
+bool parseChunks(const uint8_t* pData, size_t nSize, DstStream& cStream)
+{
+    size_t nPos = 0;
+
+    while (nPos + 12 <= nSize)
+    {
+        const uint8_t* pId = pData + nPos;
+        uint64_t nChunkSize = readBE(pData + nPos + 4, 8);
+        const uint8_t* pBody = pData + nPos + 12;
+
+        if (nChunkSize > nSize - nPos - 12)
+        {
+            return false;
+        }
+
+        if (memcmp(pId, "FRM8", 4) == 0 || memcmp(pId, "PROP", 4) == 0)
+        {
+            if (nChunkSize < 4 || !parseChunks(pBody + 4, nChunkSize - 4, cStream))
+            {
+                return false;
+            }
+        }
+        else if (memcmp(pId, "DST ", 4) == 0)
+        {
+            if (!parseChunks(pBody, nChunkSize, cStream))
+            {
+                return false;
+            }
+        }
+        else if (memcmp(pId, "FS  ", 4) == 0 && nChunkSize >= 4)
+        {
+            cStream.nSampleRate = (int)readBE(pBody, 4);
+        }
+        else if (memcmp(pId, "CHNL", 4) == 0 && nChunkSize >= 2)
+        {
+            cStream.nChannels = (int)readBE(pBody, 2);
+        }
+        else if (memcmp(pId, "DSTF", 4) == 0)
+        {
+            cStream.arrFrames.push_back(vector<uint8_t>(pBody, pBody + nChunkSize));
+        }
+
+        nPos += 12 + nChunkSize + (nChunkSize & 1);
+    }
+
+    return true;
+}
+
+bool loadStream(const char* strFile, DstStream& cStream)
+{
+    FILE* pFile = fopen(strFile, "rb");
+
+    if (!pFile)
+    {
+        fprintf(stderr, "PANIC: Failed to open %s\n", strFile);
+        return false;
+    }
+
+    vector<uint8_t> arrData;
+    uint8_t pBuf[65536];
+    size_t nRead;
+
+    while ((nRead = fread(pBuf, 1, sizeof(pBuf), pFile)) > 0)
+    {
+        arrData.insert(arrData.end(), pBuf, pBuf + nRead);
+    }
+
+    fclose(pFile);
+
+    cStream.strName = strFile;
+
+    if (!parseChunks(arrData.data(), arrData.size(), cStream) || cStream.arrFrames.empty())
+    {
+        fprintf(stderr, "PANIC: No DST frames found in %s\n", strFile);
+        return false;
+    }
+
+    return true;
+}
+
+// Least squares predictor for a +-1 sequence (Levinson-Durbin), scaled to the 9 bit DST coefficients
+vector<int> calcFilter(const vector<int>& arrBits, int nOrder)
+{
+    vector<double> arrR(nOrder + 1, 0.0);
+    vector<double> arrA(nOrder + 1, 0.0);
+    vector<double> arrT(nOrder + 1);
+
+    for (int k = 0; k <= nOrder; k++)
+    {
+        for (size_t i = k; i < arrBits.size(); i++)
+        {
+            arrR[k] += (double)(arrBits[i] * arrBits[i - k]);
+        }
+    }
+
+    double fError = arrR[0];
+
+    for (int i = 1; i <= nOrder && fError > 0.0; i++)
+    {
+        double fAcc = arrR[i];
+
+        for (int j = 1; j < i; j++)
+        {
+            fAcc -= arrA[j] * arrR[i - j];
+        }
+
+        double fK = fAcc / fError;
+
+        arrT = arrA;
+        arrA[i] = fK;
+
+        for (int j = 1; j < i; j++)
+        {
+            arrA[j] = arrT[j] - fK * arrT[i - j];
+        }
+
+        fError *= 1.0 - fK * fK;
+    }
+
+    double fMax = 0.0;
+
+    for (int i = 1; i <= nOrder; i++)
+    {
+        fMax = max(fMax, fabs(arrA[i]));
+    }
+
+    double fScale = fMax > 0.0 ? min(250.0 / fMax, 64.0) : 1.0;
+    vector<int> arrCoef(nOrder);
+
+    for (int i = 0; i < nOrder; i++)
+    {
+        arrCoef[i] = (int)lrint(arrA[i + 1] * fScale);
+    }
+
+    return arrCoef;
+}
+
+int reverse7LSBs(int c)
+{
+    int r = 0;
+
+    c = (c + (1 << 9)) & 127;
+
+    for (int i = 0; i < 7; i++)
+    {
+        r |= ((c >> i) & 1) << (6 - i);
+    }
+
+    return r + 1;
+}
+
+int log2RoundUp(long x)
+{
+    int y = 0;
+
+    while (x >= (1L << y))
+    {
+        y++;
+    }
+
+    return y;
+}
+
+// Encodes one frame of interleaved DSD with one filter and one Ptable per channel, or stores it plain when DST does not pay off
+vector<uint8_t> encodeFrame(const uint8_t* pDsd, int nChannels, int nFrameLen, int nOrder)
+{
+    int nBits = nFrameLen * 8;
+    vector<vector<int>> arrCoef(nChannels);
+    vector<vector<int>> arrPred(nChannels, vector<int>(nBits));
+    vector<vector<int>> arrPtable(nChannels, vector<int>(DST_PTABLE_LEN));
+    vector<int> arrHist(128 + nBits);
+
+    auto getBit = [&](int c, int b) { return (pDsd[(b >> 3) * nChannels + c] >> (7 - (b & 7))) & 1; };
+
+    for (int c = 0; c < nChannels; c++)
+    {
+        // The decoder starts every channel from a 0xAA history, bit j before the first bit is j & 1
+        for (int j = 0; j < 128; j++)
+        {
+            arrHist[127 - j] = (j & 1) ? 1 : -1;
+        }
+
+        for (int b = 0; b < nBits; b++)
+        {
+            arrHist[128 + b] = getBit(c, b) ? 1 : -1;
+        }
+
+        arrCoef[c] = calcFilter(vector<int>(arrHist.begin() + 128, arrHist.end()), nOrder);
+
+        vector<double> arrZero(DST_PTABLE_LEN, 0.5);
+        vector<double> arrCount(DST_PTABLE_LEN, 1.0);
+
+        for (int b = 0; b < nBits; b++)
+        {
+            int nPred = 0;
+
+            for (int j = 0; j < nOrder; j++)
+            {
+                nPred += arrCoef[c][j] * arrHist[128 + b - 1 - j];
+            }
+
+            nPred = (int16_t)nPred;
+            arrPred[c][b] = nPred;
+
+            int nIndex = min(abs(nPred) >> AC_QSTEP, DST_PTABLE_LEN - 1);
+
+            arrCount[nIndex] += 1.0;
+
+            if (((nPred < 0) ^ getBit(c, b)) == 0)
+            {
+                arrZero[nIndex] += 1.0;
+            }
+        }
+
+        for (int i = 0; i < DST_PTABLE_LEN; i++)
+        {
+            arrPtable[c][i] = max(1, min(128, (int)lrint(256.0 * arrZero[i] / arrCount[i])));
+        }
+    }
+
+    BitWriter cWriter;
+
+    cWriter.put(1, 1); // DSTCoded
+    cWriter.put(1, 1); // PSameSegAsF
+    cWriter.put(1, 1); // FSameSegAllCh
+    cWriter.put(1, 1); // EndOfChannel, a single segment
+    cWriter.put(1, 1); // PSameMapAsF
+    cWriter.put(nChannels == 1, 1); // FSameMapAllCh
+
+    for (int c = 1; c < nChannels; c++)
+    {
+        cWriter.put(c, log2RoundUp(c));
+    }
+
+    for (int c = 0; c < nChannels; c++)
+    {
+        cWriter.put(0, 1); // HalfProb
+    }
+
+    for (int c = 0; c < nChannels; c++)
+    {
+        cWriter.put(nOrder - 1, 7);
+        cWriter.put(0, 1);
+
+        for (int j = 0; j < nOrder; j++)
+        {
+            cWriter.put(arrCoef[c][j] & 0x1ff, 9);
+        }
+    }
+
+    for (int c = 0; c < nChannels; c++)
+    {
+        cWriter.put(DST_PTABLE_LEN - 1, 6);
+        cWriter.put(0, 1);
+
+        for (int i = 0; i < DST_PTABLE_LEN; i++)
+        {
+            cWriter.put(arrPtable[c][i] - 1, 7);
+        }
+    }
+
+    ACEncoder cAC;
+
+    cAC.encode(0, reverse7LSBs(arrCoef[0][0]));
+
+    for (int b = 0; b < nBits; b++)
+    {
+        for (int c = 0; c < nChannels; c++)
+        {
+            int nPred = arrPred[c][b];
+            int nIndex = min(abs(nPred) >> AC_QSTEP, DST_PTABLE_LEN - 1);
+
+            cAC.encode((nPred < 0) ^ getBit(c, b), arrPtable[c][nIndex]);
+        }
+    }
+
+    cAC.flush();
+
+    for (uint8_t nBit : cAC.arrBits)
+    {
+        cWriter.put(nBit, 1);
+    }
+
+    if (cWriter.arrData.size() >= (size_t)(nFrameLen * nChannels))
+    {
+        BitWriter cPlain;
+
+        cPlain.put(0, 8);
+
+        for (int i = 0; i < nFrameLen * nChannels; i++)
+        {
+            cPlain.put(pDsd[i], 8);
+        }
+
+        return cPlain.arrData;
+    }
+
+    return cWriter.arrData;
+}
+
+// Second order sigma-delta modulation of two tones plus noise, a different pitch per channel
+void makeStream(DstStream& cStream, int nChannels, int nSampleRate, int nFrames)
+{
+    int nFrameLen = nSampleRate / 8 / FRAMERATE;
+    vector<uint8_t> arrDsd((size_t)nFrameLen * nChannels);
+    vector<double> arrI1(nChannels, 0.0), arrI2(nChannels, 0.0), arrPhase(nChannels, 0.0);
+    vector<int> arrY(nChannels, 1);
+    uint32_t nSeed = 12345;
+
+    cStream.strName = "synthetic";
+    cStream.nChannels = nChannels;
+    cStream.nSampleRate = nSampleRate;
+
+    for (int f = 0; f < nFrames; f++)
+    {
+        for (int i = 0; i < nFrameLen; i++)
+        {
+            for (int c = 0; c < nChannels; c++)
+            {
+                uint8_t nByte = 0;
+                double fAmp = 0.3 + 0.03 * c;
+
+                for (int b = 0; b < 8; b++)
+                {
+                    nSeed = nSeed * 1664525u + 1013904223u;
+
+                    double x = fAmp * (sin(arrPhase[c]) + 0.1 * sin(arrPhase[c] * 3.7)) + 0.3 * ((double)(nSeed >> 8) / 16777216.0 - 0.5);
+
+                    arrPhase[c] += 2.0 * M_PI * 220.0 * (c + 1) / nSampleRate;
+                    arrI1[c] += x - arrY[c];
+                    arrI2[c] += arrI1[c] - arrY[c];
+                    arrY[c] = arrI2[c] >= 0.0 ? 1 : -1;
+                    nByte = (nByte << 1) | (arrY[c] > 0);
+                }
+
+                arrDsd[(size_t)i * nChannels + c] = nByte;
+            }
+        }
+
+        cStream.arrFrames.push_back(encodeFrame(arrDsd.data(), nChannels, nFrameLen, 32 + 16 * (f % 7)));
+        cStream.arrDsd.push_back(arrDsd);
+    }
+}
+
+void printResult(const char* strLabel, const DstStream& cStream, int nFrames, double fTime)
+{
+    double fDsdBytes = (double)nFrames * (cStream.nSampleRate / 8 / FRAMERATE) * cStream.nChannels;
+
+    fprintf(stderr, "  %-32s %9.1f frames/s %8.1f MB/s %7.1fx realtime\n", strLabel, nFrames / fTime, fDsdBytes / fTime / 1e6, (double)nFrames / FRAMERATE / fTime);
+}
+
+// Frame nFrameNr of the decoded stream, counted over all repeats, matches the DSD of the stream
+bool checkFrame(const DstStream& cStream, size_t nFrameNr, const uint8_t* pDsdData)
+{
+    const vector<uint8_t>& arrDsd = cStream.arrDsd[nFrameNr % cStream.arrDsd.size()];
+
+    return memcmp(pDsdData, arrDsd.data(), arrDsd.size()) == 0;
+}
+
+bool runSingle(DstStream& cStream, int nRepeats)
+{
+    CDSTDecoder* pDecoder = new CDSTDecoder();
+    vector<uint8_t> arrDsd(cStream.nSampleRate / 8 / FRAMERATE * cStream.nChannels);
+    bool bReference = cStream.arrDsd.empty();
+    int nErrors = 0;
+    int nMismatches = 0;
+    size_t nFrameNr = 0;
+
+    if (pDecoder->init(cStream.nChannels, cStream.nSampleRate / 44100) != DST_NOERROR)
+    {
+        fprintf(stderr, "PANIC: Failed to initialize the DST decoder\n");
+        delete pDecoder;
+        return false;
+    }
+
+    pDecoder->Timing.Enabled = true;
+
+    double fStart = getTime();
+
+    for (int r = 0; r < nRepeats; r++)
+    {
+        for (const vector<uint8_t>& arrFrame : cStream.arrFrames)
+        {
+            if (pDecoder->decode((uint8_t*)arrFrame.data(), (int)arrFrame.size() * 8, arrDsd.data()) != DST_NOERROR)
+            {
+                nErrors++;
+            }
+
+            // A file has no source DSD, its first decode is the reference for the repeats and the multithreaded decoder
+            if (bReference && r == 0)
+            {
+                cStream.arrDsd.push_back(arrDsd);
+            }
+            else if (!checkFrame(cStream, nFrameNr, arrDsd.data()))
+            {
+                nMismatches++;
+            }
+
+            nFrameNr++;
+        }
+    }
+
+    double fTime = getTime() - fStart;
+    int nFrames = nRepeats * (int)cStream.arrFrames.size();
+    CDSTTiming& cTiming = pDecoder->Timing;
+
+    printResult("1 thread", cStream, nFrames, fTime);
+    fprintf(stderr, "  %-32s unpack %.1f us, tables %.1f us, arithmetic decoding %.1f us per frame\n", "", cTiming.Unpack * 1e6 / nFrames, cTiming.Tables * 1e6 / nFrames, cTiming.Decode * 1e6 / nFrames);
+
+    if (nErrors > 0)
+    {
+        fprintf(stderr, "  WARNING: %d frames failed to decode\n", nErrors);
+    }
+
+    if (nMismatches > 0)
+    {
+        fprintf(stderr, "  ERROR: %d frames differ from the source DSD\n", nMismatches);
+    }
+
+    delete pDecoder;
+
+    return nMismatches == 0;
+}
+
+bool runMulti(const DstStream& cStream, int nRepeats, int nThreads, int nDepth, int nBatch)
+{
+    dst_decoder_t* pDecoder = new dst_decoder_t(nThreads, nDepth);
+    size_t nDsdBufSize = cStream.nSampleRate / 8 / FRAMERATE * cStream.nChannels;
+    vector<uint8_t> arrDsd(nDsdBufSize * pDecoder->get_frame_count());
+    uint8_t* pDsdData;
+    size_t nDsdSize;
+    int nFrames = 0;
+    int nMismatches = 0;
+
+    if (pDecoder->init(cStream.nChannels, cStream.nSampleRate, FRAMERATE) != 0)
+    {
+        fprintf(stderr, "PANIC: Failed to initialize the DST decoder\n");
+        delete pDecoder;
+        return false;
+    }
+
+    double fStart = getTime();
+
+    if (nBatch <= 1)
+    {
+        for (int r = 0; r < nRepeats; r++)
+        {
+            for (const vector<uint8_t>& arrFrame : cStream.arrFrames)
+            {
+                pDsdData = arrDsd.data() + nDsdBufSize * pDecoder->slot_nr;
+                pDecoder->decode((uint8_t*)arrFrame.data(), arrFrame.size(), &pDsdData, &nDsdSize);
+
+                // Frames come back in stream order
+                if (nDsdSize > 0)
+                {
+                    nMismatches += !checkFrame(cStream, nFrames++, pDsdData);
+                }
+            }
+        }
+
+        do
+        {
+            pDsdData = nullptr;
+            pDecoder->decode(nullptr, 0, &pDsdData, &nDsdSize);
+
+            if (nDsdSize > 0)
+            {
+                nMismatches += !checkFrame(cStream, nFrames++, pDsdData);
+            }
+        }
+        while (nDsdSize > 0);
+    }
+    else
+    {
+        // One DSD buffer per slot, a buffer is free again once its frame is received
+        vector<dst_frame_t> arrIn, arrOut(nBatch);
+        vector<intptr_t> arrFree;
+        size_t nTotal = (size_t)nRepeats * cStream.arrFrames.size();
+        size_t nPos = 0;
+
+        for (int i = pDecoder->get_frame_count() - 1; i >= 0; i--)
+        {
+            arrFree.push_back(i);
+        }
+
+        while (nPos < nTotal || pDecoder->get_frames_in_flight() > 0)
+        {
+            arrIn.clear();
+
+            while ((int)arrIn.size() < nBatch && nPos < nTotal && !arrFree.empty())
+            {
+                const vector<uint8_t>& arrFrame = cStream.arrFrames[nPos++ % cStream.arrFrames.size()];
+                dst_frame_t cFrame;
+
+                cFrame.dst_data = (uint8_t*)arrFrame.data();
+                cFrame.dst_size = arrFrame.size();
+                cFrame.dsd_data = arrDsd.data() + nDsdBufSize * arrFree.back();
+                cFrame.user_data = (void*)arrFree.back();
+                arrFree.pop_back();
+                arrIn.push_back(cFrame);
+            }
+
+            pDecoder->submit(arrIn.data(), (int)arrIn.size());
+
+            int nDone = nPos < nTotal ? pDecoder->receive(arrOut.data(), nBatch, true) : pDecoder->drain(arrOut.data(), nBatch);
+
+            for (int i = 0; i < nDone; i++)
+            {
+                nMismatches += !checkFrame(cStream, arrOut[i].frame_nr, arrOut[i].dsd_data);
+                arrFree.push_back((intptr_t)arrOut[i].user_data);
+            }
+
+            nFrames += nDone;
+        }
+    }
+
+    double fTime = getTime() - fStart;
+    string strLabel = "mt, " + to_string(nThreads) + (nThreads == 1 ? " thread" : " threads") + ", " + to_string(pDecoder->get_frame_count()) + " deep";
+
+    if (nBatch > 1)
+    {
+        strLabel += ", batch " + to_string(nBatch);
+    }
+
+    const dst_stats_t& cStats = pDecoder->get_stats();
+
+    printResult(strLabel.c_str(), cStream, nFrames, fTime);
+    fprintf(stderr, "  %-32s blocked on the oldest frame %u times, %.1f ms\n", "", cStats.hol_waits, cStats.hol_wait_time * 1e3);
+
+    if (pDecoder->get_stats().errors > 0)
+    {
+        fprintf(stderr, "  WARNING: %u frames failed to decode\n", pDecoder->get_stats().errors);
+    }
+
+    if (nMismatches > 0)
+    {
+        fprintf(stderr, "  ERROR: %d frames differ from the source DSD\n", nMismatches);
+    }
+
+    delete pDecoder;
+
+    return nMismatches == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int nOpt;
+    int nRepeats = 10;
+    int nFrames = FRAMERATE;
+    int nThreads = max(1, (int)thread::hardware_concurrency());
+    int nDepth = 0;
+    int nBatch = 1;
+    int nChannels = 0;
+    int nSampleRate = 2822400;
+    bool bPrintHelp = false;
+    bool bMatch = true;
+
+    const char* strHelpText =
+    "\n"
+    "Usage: dst_bench [options] [file]\n\n"
+    "  Decodes the DST frames of a DSDIFF file, or of a stream of dumped DSTF\n"
+    "  chunks, and reports the DST decoder throughput. Without a file, 2 and 6\n"
+    "  channel DST streams are encoded from a synthetic signal.\n\n"
+    "  -n, --repeats        : Decode the frames this many times (default: 10)\n"
+    "  -t, --threads        : Threads of the multithreaded decoder (default: CPUs)\n"
+    "  -d, --depth          : Frames in flight in the multithreaded decoder\n"
+    "                         (default: threads)\n"
+    "  -b, --batch          : Submit and receive this many frames per call\n"
+    "                         (default: 1, one frame per decode() call)\n"
+    "  -f, --frames         : Frames of the synthetic streams (default: 75)\n"
+    "  -c, --channels       : Channels of a DSTF stream without a PROP chunk\n"
+    "  -r, --rate           : DSD samplerate of a DSTF stream without a PROP\n"
+    "                         chunk (default: 2822400)\n"
+    "  -h, --help           : Show this help message\n\n";
+
+    const struct option tOptionsTable[] =
+    {
+        {"repeats", required_argument, NULL, 'n' },
+        {"threads", required_argument, NULL, 't' },
+        {"depth", required_argument, NULL, 'd' },
+        {"batch", required_argument, NULL, 'b' },
+        {"frames", required_argument, NULL, 'f' },
+        {"channels", required_argument, NULL, 'c' },
+        {"rate", required_argument, NULL, 'r' },
+        {"help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((nOpt = getopt_long(argc, argv, "n:t:d:b:f:c:r:h", tOptionsTable, NULL)) >= 0)
+    {
+        switch (nOpt)
+        {
+            case 'n':
+                nRepeats = atoi(optarg);
+                break;
+            case 't':
+                nThreads = atoi(optarg);
+                break;
+            case 'd':
+                nDepth = atoi(optarg);
+                break;
+            case 'b':
+                nBatch = atoi(optarg);
+                break;
+            case 'f':
+                nFrames = atoi(optarg);
+                break;
+            case 'c':
+                nChannels = atoi(optarg);
+                break;
+            case 'r':
+                nSampleRate = atoi(optarg);
+                break;
+            default:
+                bPrintHelp = true;
+                break;
+        }
+    }
+
+    if (bPrintHelp || nRepeats < 1 || nThreads < 1 || nDepth < 0 || nBatch < 1 || nFrames < 1 || nChannels < 0 || nChannels > MAX_CHANNELS || nSampleRate < 44100 * 64 || nSampleRate % (44100 * 64) != 0)
+    {
+        fprintf(stderr, "%s", strHelpText);
+        return 1;
+    }
+
+    vector<DstStream> arrStreams;
+
+    if (optind < argc)
+    {
+        DstStream cStream;
+
+        cStream.nChannels = nChannels;
+        cStream.nSampleRate = nSampleRate;
+
+        if (!loadStream(argv[optind], cStream))
+        {
+            return 1;
+        }
+
+        if (cStream.nChannels < 1 || cStream.nChannels > MAX_CHANNELS)
+        {
+            fprintf(stderr, "PANIC: Unknown channel count, use --channels\n");
+            return 1;
+        }
+
+        arrStreams.push_back(cStream);
+    }
+    else
+    {
+        for (int nCh : {2, 6})
+        {
+            arrStreams.push_back(DstStream());
+            makeStream(arrStreams.back(), nCh, nSampleRate, nFrames);
+        }
+    }
+
+    for (DstStream& cStream : arrStreams)
+    {
+        size_t nDstBytes = 0;
+
+        for (const vector<uint8_t>& arrFrame : cStream.arrFrames)
+        {
+            nDstBytes += arrFrame.size();
+        }
+
+        double fRatio = (double)nDstBytes / ((double)cStream.arrFrames.size() * (cStream.nSampleRate / 8 / FRAMERATE) * cStream.nChannels);
+
+        fprintf(stderr, "%s: %d channels, %d Hz, %d frames x %d, compressed to %.1f%%\n", cStream.strName.c_str(), cStream.nChannels, cStream.nSampleRate, (int)cStream.arrFrames.size(), nRepeats, fRatio * 100.0);
+
+        bMatch &= runSingle(cStream, nRepeats);
+        bMatch &= runMulti(cStream, nRepeats, nThreads, nDepth, nBatch);
+    }
+
+    return bMatch ? 0 : 1;
+}
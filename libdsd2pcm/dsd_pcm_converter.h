@@ -39,6 +39,7 @@ enum declick_side_e
     DECLICK_RIGHT = 2
 };
 
+template<typename real_t>
 class DSDPCMConverter
 {
 protected:
@@ -47,8 +48,8 @@ protected:
     int dsd_samplerate;
     int pcm_samplerate;
     float delay;
-    double* pcm_temp1;
-    double* pcm_temp2;
+    real_t* pcm_temp1;
+    real_t* pcm_temp2;
 
 public:
 
@@ -69,21 +70,22 @@ public:
         return delay;
     }
 
-    virtual void init(DSDPCMFilterSetup& flt_setup, int dsd_samples) = 0;
-    virtual int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples) = 0;
+    virtual void init(int dsd_samples) = 0;
+    virtual void reset() = 0; // Clears the filter history for a new stream of the same format
+    virtual int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1) = 0;
 
 protected:
 
     void alloc_pcm_temp1(int pcm_samples)
     {
         free_pcm_temp1();
-        pcm_temp1 = (double*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(double));
+        pcm_temp1 = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
     }
 
     void alloc_pcm_temp2(int pcm_samples)
     {
         free_pcm_temp2();
-        pcm_temp2 = (double*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(double));
+        pcm_temp2 = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
     }
 
     void free_pcm_temp1()
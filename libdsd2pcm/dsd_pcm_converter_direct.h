@@ -0,0 +1,59 @@
+/*
+    Copyright (c) 2015-2016 Robert Tari <robert@tari.in>
+    Copyright (c) 2011-2015 Maxim V.Anisiutkin <maxim.anisiutkin@gmail.com>
+
+    This file is part of SACD.
+
+    SACD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SACD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#pragma once
+
+#include "dsd_pcm_converter.h"
+
+// Single stage conversion with the 641 tap DSDFIR1_64 filter. It passes up to about 20 kHz at DSD64 (the
+// band scales with the DSD rate) and is down 69 dB at 1/64 of the DSD rate, so it serves decimations of 32
+// and below; at 64 and above the band it passes would alias.
+template<typename real_t>
+class DSDPCMConverterDirect : public DSDPCMConverter<real_t>
+{
+    DSDPCMFir<real_t> dsd_fir1;
+    int decimation;
+
+public:
+
+    DSDPCMConverterDirect(int decimation)
+    {
+        this->decimation = decimation;
+    }
+
+    void init(int dsd_samples)
+    {
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_64_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_64_length(), decimation, dsd_samples);
+        this->delay = dsd_fir1.get_delay();
+    }
+
+    void reset()
+    {
+        dsd_fir1.reset();
+    }
+
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
+    {
+        int pcm_samples;
+        pcm_samples = dsd_fir1.run(dsd_data, pcm_data, dsd_samples, dsd_stride);
+
+        return pcm_samples;
+    }
+};
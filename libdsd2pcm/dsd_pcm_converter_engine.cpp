@@ -18,11 +18,52 @@
     along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
 */
 
+#include <math.h>
 #include "dsd_pcm_converter_engine.h"
 
+// Writes one channel into the interleaved output. The int24 rounding matches a float sample scaled to 24 bits.
+template<typename real_t>
+static void write_pcm(const real_t* pcm_data, int pcm_samples, uint8_t* pcm_out, int pcm_stride, int pcm_format)
+{
+    for (int sample = 0; sample < pcm_samples; sample++, pcm_out += pcm_stride)
+    {
+        switch (pcm_format)
+        {
+            case PCM_FORMAT_FLOAT:
+                *(float*)pcm_out = (float)pcm_data[sample];
+                break;
+            case PCM_FORMAT_INT32:
+            {
+                double value = pcm_data[sample] * 2147483648.0;
+                value = value < 2147483647.0 ? value : 2147483647.0;
+                value = value > -2147483648.0 ? value : -2147483648.0;
+                int32_t out = (int32_t)lrint(value);
+                pcm_out[0] = out;
+                pcm_out[1] = out >> 8;
+                pcm_out[2] = out >> 16;
+                pcm_out[3] = out >> 24;
+                break;
+            }
+            case PCM_FORMAT_INT24:
+            {
+                float value = (float)pcm_data[sample];
+                value = value < 1.0f ? value : 1.0f;
+                value = value > -1.0f ? value : -1.0f;
+                int32_t out = lrintf(value * 8388608.0f);
+                out = out < 8388607 ? out : 8388607;
+                pcm_out[0] = out;
+                pcm_out[1] = out >> 8;
+                pcm_out[2] = out >> 16;
+                break;
+            }
+        }
+    }
+}
+
+template<typename real_t>
 static void* ConverterThread(void* threadarg)
 {
-    DSDPCMConverterSlot* slot = reinterpret_cast<DSDPCMConverterSlot*>(threadarg);
+    DSDPCMConverterSlot<real_t>* slot = reinterpret_cast<DSDPCMConverterSlot<real_t>*>(threadarg);
 
     while (1)
     {
@@ -43,7 +84,21 @@ static void* ConverterThread(void* threadarg)
         slot->state = PCM_SLOT_RUNNING;
         pthread_mutex_unlock(&slot->hMutex);
 
-        slot->pcm_samples = slot->converter->convert(slot->dsd_data, slot->pcm_data, slot->dsd_samples);
+        slot->pcm_samples = slot->converter->convert(slot->dsd_input, slot->pcm_data, slot->dsd_samples, slot->dsd_stride);
+
+        if (slot->pcm_out)
+        {
+            write_pcm(slot->pcm_data, slot->pcm_samples, slot->pcm_out, slot->pcm_stride, slot->pcm_format);
+        }
+
+        // Keep the channel of an interleaved frame while it is still in cache, convertR() may need it
+        if (slot->dsd_input != slot->dsd_data)
+        {
+            for (int sample = 0; sample < slot->dsd_samples; sample++)
+            {
+                slot->dsd_data[sample] = slot->dsd_input[sample * slot->dsd_stride];
+            }
+        }
 
         pthread_mutex_lock(&slot->hMutex);
         slot->state = PCM_SLOT_READY;
@@ -61,8 +116,12 @@ DSDPCMConverterEngine::DSDPCMConverterEngine()
     dsd_samplerate = 0;
     pcm_samplerate = 0;
     conv_delay = 0.0f;
+    conv_fp64 = true;
+    conv_type = DSDPCM_CONV_MULTISTAGE;
+    convSlots_fp32 = nullptr;
     convSlots_fp64 = nullptr;
     conv_called = false;
+    pcm_format = PCM_FORMAT_FLOAT;
 
     for (int i = 0; i < 256; i++)
     {
@@ -92,23 +151,89 @@ bool DSDPCMConverterEngine::is_convert_called()
     return conv_called;
 }
 
-int DSDPCMConverterEngine::init(int channels, int framerate, int dsd_samplerate, int pcm_samplerate)
+// Can be called again for every new stream. When the format is unchanged the channel threads, buffers and
+// filters are kept and only the filter history is cleared. conv_fp64 selects the double precision filters,
+// the single precision ones run twice the SIMD lanes and stay within about 1e-6 of full scale (see README).
+// conv_type is a conv_type_e: DSDPCM_CONV_DIRECT filters in one stage with DSDFIR1_64 where it fits (a
+// decimation of 32 or below), narrower and slower than the multistage chain at every rate (see README).
+int DSDPCMConverterEngine::init(int channels, int framerate, int dsd_samplerate, int pcm_samplerate, bool conv_fp64, int conv_type)
 {
-    free();
+    if ((convSlots_fp32 || convSlots_fp64) && channels == this->channels && framerate == this->framerate && dsd_samplerate == this->dsd_samplerate && pcm_samplerate == this->pcm_samplerate && conv_fp64 == this->conv_fp64 && conv_type == this->conv_type)
+    {
+        if (convSlots_fp32)
+        {
+            reset_slots(convSlots_fp32);
+        }
+
+        if (convSlots_fp64)
+        {
+            reset_slots(convSlots_fp64);
+        }
+    }
+    else
+    {
+        free();
+
+        this->channels = channels;
+        this->framerate = framerate;
+        this->dsd_samplerate = dsd_samplerate;
+        this->pcm_samplerate = pcm_samplerate;
+        this->conv_fp64 = conv_fp64;
+        this->conv_type = conv_type;
+
+        if (conv_fp64)
+        {
+            convSlots_fp64 = init_slots<double>();
+            conv_delay = convSlots_fp64[0].converter->get_delay();
+        }
+        else
+        {
+            convSlots_fp32 = init_slots<float>();
+            conv_delay = convSlots_fp32[0].converter->get_delay();
+        }
+    }
 
-    this->channels = channels;
-    this->framerate = framerate;
-    this->dsd_samplerate = dsd_samplerate;
-    this->pcm_samplerate = pcm_samplerate;
-    convSlots_fp64 = init_slots(fltSetup_fp64);
-    conv_delay = convSlots_fp64[0].converter->get_delay();
     conv_called = false;
 
     return 0;
 }
 
+// Binds the channel threads started by the next init() to the given CPU sets, in turn. The channel buffers
+// are allocated and first written by the thread calling init(), so bind that thread to the same node for
+// node-local memory. A count of 0 lets the threads run anywhere.
+void DSDPCMConverterEngine::set_affinity(const cpu_set_t* cpus, int count)
+{
+    thread_cpus.assign(cpus, cpus + count);
+}
+
+// Output sample format of convert(), a pcm_format_e. Float unless set.
+void DSDPCMConverterEngine::set_pcm_format(int pcm_format)
+{
+    this->pcm_format = pcm_format;
+}
+
+// Bytes per sample of one channel in the output
+int DSDPCMConverterEngine::get_pcm_sample_size()
+{
+    switch (pcm_format)
+    {
+        case PCM_FORMAT_INT24:
+            return 3;
+        case PCM_FORMAT_INT32:
+            return sizeof(int32_t);
+        default:
+            return sizeof(float);
+    }
+}
+
 int DSDPCMConverterEngine::free()
 {
+    if (convSlots_fp32)
+    {
+        free_slots(convSlots_fp32);
+        convSlots_fp32 = nullptr;
+    }
+
     if (convSlots_fp64)
     {
         free_slots(convSlots_fp64);
@@ -118,12 +243,19 @@ int DSDPCMConverterEngine::free()
     return 0;
 }
 
-int DSDPCMConverterEngine::convert(uint8_t* dsd_data, int dsd_samples, float* pcm_data)
+// Converts an interleaved DSD frame to interleaved PCM in the format set by set_pcm_format(). The channel
+// workers write the output themselves. A null dsd_data flushes the end of the stream.
+int DSDPCMConverterEngine::convert(uint8_t* dsd_data, int dsd_samples, void* pcm_data)
 {
     int pcm_samples = 0;
 
     if (!dsd_data)
     {
+        if (convSlots_fp32)
+        {
+            pcm_samples = convertR(convSlots_fp32, pcm_data);
+        }
+
         if (convSlots_fp64)
         {
             pcm_samples = convertR(convSlots_fp64, pcm_data);
@@ -134,6 +266,11 @@ int DSDPCMConverterEngine::convert(uint8_t* dsd_data, int dsd_samples, float* pc
 
     if (!conv_called)
     {
+        if (convSlots_fp32)
+        {
+            convertL(convSlots_fp32, dsd_data, dsd_samples);
+        }
+
         if (convSlots_fp64)
         {
             convertL(convSlots_fp64, dsd_data, dsd_samples);
@@ -142,6 +279,11 @@ int DSDPCMConverterEngine::convert(uint8_t* dsd_data, int dsd_samples, float* pc
         conv_called = true;
     }
 
+    if (convSlots_fp32)
+    {
+        pcm_samples = convert(convSlots_fp32, dsd_data, dsd_samples, pcm_data);
+    }
+
     if (convSlots_fp64)
     {
         pcm_samples = convert(convSlots_fp64, dsd_data, dsd_samples, pcm_data);
@@ -150,9 +292,10 @@ int DSDPCMConverterEngine::convert(uint8_t* dsd_data, int dsd_samples, float* pc
     return pcm_samples;
 }
 
-DSDPCMConverterSlot* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup& fltSetup)
+template<typename real_t>
+DSDPCMConverterSlot<real_t>* DSDPCMConverterEngine::init_slots()
 {
-    DSDPCMConverterSlot* convSlots = new DSDPCMConverterSlot[channels];
+    DSDPCMConverterSlot<real_t>* convSlots = new DSDPCMConverterSlot<real_t>[channels];
 
     int dsd_samples = dsd_samplerate / 8 / framerate;
     int pcm_samples = pcm_samplerate / framerate;
@@ -160,56 +303,96 @@ DSDPCMConverterSlot* DSDPCMConverterEngine::init_slots(DSDPCMFilterSetup& fltSet
 
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
         slot->dsd_data = (uint8_t*)DSDPCMUtil::mem_alloc(dsd_samples * sizeof(uint8_t));
         slot->dsd_samples = dsd_samples;
-        slot->pcm_data = (double*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(double));
+        slot->pcm_data = (real_t*)DSDPCMUtil::mem_alloc(pcm_samples * sizeof(real_t));
         slot->pcm_samples = 0;
 
-        DSDPCMConverterMultistage* pConv = nullptr;
+        DSDPCMConverter<real_t>* pConv = nullptr;
 
-        switch (decimation)
+        if (conv_type == DSDPCM_CONV_DIRECT && decimation >= 8 && decimation <= 32)
         {
-            case 512:
-                pConv = new DSDPCMConverterMultistage_x512();
-                break;
-            case 256:
-                pConv = new DSDPCMConverterMultistage_x256();
-                break;
-            case 128:
-                pConv = new DSDPCMConverterMultistage_x128();
-                break;
-            case 64:
-                pConv = new DSDPCMConverterMultistage_x64();
-                break;
-            case 32:
-                pConv = new DSDPCMConverterMultistage_x32();
-                break;
-            case 16:
-                pConv = new DSDPCMConverterMultistage_x16();
-                break;
-            case 8:
-                pConv = new DSDPCMConverterMultistage_x8();
-                break;
+            pConv = new DSDPCMConverterDirect<real_t>(decimation);
+        }
+
+        // The multistage chain is the faster one at every decimation, and the only one above 32
+        if (!pConv)
+        {
+            switch (decimation)
+            {
+                case 512:
+                    pConv = new DSDPCMConverterMultistage_x512<real_t>();
+                    break;
+                case 256:
+                    pConv = new DSDPCMConverterMultistage_x256<real_t>();
+                    break;
+                case 128:
+                    pConv = new DSDPCMConverterMultistage_x128<real_t>();
+                    break;
+                case 64:
+                    pConv = new DSDPCMConverterMultistage_x64<real_t>();
+                    break;
+                case 32:
+                    pConv = new DSDPCMConverterMultistage_x32<real_t>();
+                    break;
+                case 16:
+                    pConv = new DSDPCMConverterMultistage_x16<real_t>();
+                    break;
+                case 8:
+                    pConv = new DSDPCMConverterMultistage_x8<real_t>();
+                    break;
+            }
         }
 
-        pConv->init(fltSetup, dsd_samples);
+        pConv->init(dsd_samples);
         slot->converter = pConv;
 
         pthread_mutex_init(&slot->hMutex, NULL);
         pthread_cond_init(&slot->hEventGet, NULL);
         pthread_cond_init(&slot->hEventPut, NULL);
-        pthread_create(&slot->hThread, NULL, ConverterThread, slot);
+
+        pthread_attr_t hAttr;
+        pthread_attr_init(&hAttr);
+
+        if (!thread_cpus.empty())
+        {
+            pthread_attr_setaffinity_np(&hAttr, sizeof(cpu_set_t), &thread_cpus[ch % thread_cpus.size()]);
+        }
+
+        pthread_create(&slot->hThread, &hAttr, ConverterThread<real_t>, slot);
+        pthread_attr_destroy(&hAttr);
     }
 
     return convSlots;
 }
 
-void DSDPCMConverterEngine::free_slots(DSDPCMConverterSlot* convSlots)
+// The channel threads are idle between frames, so the converters can be reset from the calling thread
+template<typename real_t>
+void DSDPCMConverterEngine::reset_slots(DSDPCMConverterSlot<real_t>* convSlots)
 {
+    int dsd_samples = dsd_samplerate / 8 / framerate;
+
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
+        slot->dsd_samples = dsd_samples;
+        slot->pcm_samples = 0;
+        slot->converter->reset();
+
+        if (!thread_cpus.empty())
+        {
+            pthread_setaffinity_np(slot->hThread, sizeof(cpu_set_t), &thread_cpus[ch % thread_cpus.size()]);
+        }
+    }
+}
+
+template<typename real_t>
+void DSDPCMConverterEngine::free_slots(DSDPCMConverterSlot<real_t>* convSlots)
+{
+    for (int ch = 0; ch < channels; ch++)
+    {
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 
         // Release worker (decoding) thread for exit
         pthread_mutex_lock(&slot->hMutex);
@@ -237,19 +420,20 @@ void DSDPCMConverterEngine::free_slots(DSDPCMConverterSlot* convSlots)
     convSlots = nullptr;
 }
 
-int DSDPCMConverterEngine::convert(DSDPCMConverterSlot* convSlots, uint8_t* dsd_data, int dsd_samples, float* pcm_data)
+template<typename real_t>
+int DSDPCMConverterEngine::convert(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, void* pcm_data)
 {
     int pcm_samples = 0;
 
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
         slot->dsd_samples = dsd_samples / channels;
 
-        for (int sample = 0; sample < slot->dsd_samples; sample++)
-        {
-            slot->dsd_data[sample] = dsd_data[sample * channels + ch];
-        }
+        // The worker reads its channel straight from the interleaved frame
+        slot->dsd_input = dsd_data + ch;
+        slot->dsd_stride = channels;
+        set_output(slot, ch, pcm_data);
 
         // Release worker (decoding) thread on the loaded slot
         pthread_mutex_lock(&slot->hMutex);
@@ -260,7 +444,7 @@ int DSDPCMConverterEngine::convert(DSDPCMConverterSlot* convSlots, uint8_t* dsd_
 
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 
         // Wait until worker (decoding) thread is complete
         pthread_mutex_lock(&slot->hMutex);
@@ -272,22 +456,18 @@ int DSDPCMConverterEngine::convert(DSDPCMConverterSlot* convSlots, uint8_t* dsd_
 
         pthread_mutex_unlock(&slot->hMutex);
 
-        for (int sample = 0; sample < slot->pcm_samples; sample++)
-        {
-            pcm_data[sample * channels + ch] = (float)slot->pcm_data[sample];
-        }
-
         pcm_samples += slot->pcm_samples;
     }
 
     return pcm_samples;
 }
 
-int DSDPCMConverterEngine::convertL(DSDPCMConverterSlot* convSlots, uint8_t* dsd_data, int dsd_samples)
+template<typename real_t>
+int DSDPCMConverterEngine::convertL(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples)
 {
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 
         slot->dsd_samples = dsd_samples / channels;
 
@@ -296,6 +476,10 @@ int DSDPCMConverterEngine::convertL(DSDPCMConverterSlot* convSlots, uint8_t* dsd
             slot->dsd_data[sample] = swap_bits[dsd_data[(slot->dsd_samples - 1 - sample) * channels + ch]];
         }
 
+        slot->dsd_input = slot->dsd_data;
+        slot->dsd_stride = 1;
+        slot->pcm_out = nullptr;
+
         // Release worker (decoding) thread on the loaded slot
         pthread_mutex_lock(&convSlots[ch].hMutex);
         convSlots[ch].state = PCM_SLOT_LOADED;
@@ -305,7 +489,7 @@ int DSDPCMConverterEngine::convertL(DSDPCMConverterSlot* convSlots, uint8_t* dsd
 
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 
         // Wait until worker (decoding) thread is complete
         pthread_mutex_lock(&slot->hMutex);
@@ -321,13 +505,14 @@ int DSDPCMConverterEngine::convertL(DSDPCMConverterSlot* convSlots, uint8_t* dsd
     return 0;
 }
 
-int DSDPCMConverterEngine::convertR(DSDPCMConverterSlot* convSlots, float* pcm_data)
+template<typename real_t>
+int DSDPCMConverterEngine::convertR(DSDPCMConverterSlot<real_t>* convSlots, void* pcm_data)
 {
     int pcm_samples = 0;
 
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 
         for (int sample = 0; sample < slot->dsd_samples / 2; sample++)
         {
@@ -336,6 +521,10 @@ int DSDPCMConverterEngine::convertR(DSDPCMConverterSlot* convSlots, float* pcm_d
             slot->dsd_data[sample] = swap_bits[temp];
         }
 
+        slot->dsd_input = slot->dsd_data;
+        slot->dsd_stride = 1;
+        set_output(slot, ch, pcm_data);
+
         // Release worker (decoding) thread on the loaded slot
         pthread_mutex_lock(&convSlots[ch].hMutex);
         convSlots[ch].state = PCM_SLOT_LOADED;
@@ -345,7 +534,7 @@ int DSDPCMConverterEngine::convertR(DSDPCMConverterSlot* convSlots, float* pcm_d
 
     for (int ch = 0; ch < channels; ch++)
     {
-        DSDPCMConverterSlot* slot = &convSlots[ch];
+        DSDPCMConverterSlot<real_t>* slot = &convSlots[ch];
 
         // Wait until worker (decoding) thread is complete
         pthread_mutex_lock(&slot->hMutex);
@@ -357,13 +546,16 @@ int DSDPCMConverterEngine::convertR(DSDPCMConverterSlot* convSlots, float* pcm_d
 
         pthread_mutex_unlock(&slot->hMutex);
 
-        for (int sample = 0; sample < slot->pcm_samples; sample++)
-        {
-            pcm_data[sample * channels + ch] = (float)slot->pcm_data[sample];
-        }
-
         pcm_samples += slot->pcm_samples;
     }
 
     return pcm_samples;
 }
+
+template<typename real_t>
+void DSDPCMConverterEngine::set_output(DSDPCMConverterSlot<real_t>* slot, int ch, void* pcm_data)
+{
+    slot->pcm_out = (uint8_t*)pcm_data + ch * get_pcm_sample_size();
+    slot->pcm_stride = channels * get_pcm_sample_size();
+    slot->pcm_format = pcm_format;
+}
@@ -21,19 +21,31 @@
 #pragma once
 
 #include <pthread.h>
+#include <sched.h>
+#include <vector>
 #include "dsd_pcm_converter_multistage.h"
+#include "dsd_pcm_converter_direct.h"
 
 enum pcm_slot_state_t {PCM_SLOT_EMPTY, PCM_SLOT_LOADED, PCM_SLOT_RUNNING, PCM_SLOT_READY, PCM_SLOT_TERMINATING};
 
+// Sample format of the interleaved output: float in [-1, 1], full scale little-endian int32 or packed int24
+enum pcm_format_e {PCM_FORMAT_FLOAT, PCM_FORMAT_INT32, PCM_FORMAT_INT24};
+
+template<typename real_t>
 class DSDPCMConverterSlot
 {
 public:
 
-    uint8_t* dsd_data;
+    uint8_t* dsd_data; // The channel's last frame, kept for the reversed tail at the end of the stream
     int dsd_samples;
-    double* pcm_data;
+    uint8_t* dsd_input; // Where the worker reads the frame: the caller's interleaved frame or dsd_data
+    int dsd_stride;
+    real_t* pcm_data;
     int pcm_samples;
-    DSDPCMConverter* converter;
+    uint8_t* pcm_out; // The channel's first sample in the caller's interleaved output, nullptr to drop the output
+    int pcm_stride; // Bytes between the channel's output samples
+    int pcm_format;
+    DSDPCMConverter<real_t>* converter;
     pthread_t hThread;
     pthread_cond_t hEventGet;
     pthread_cond_t hEventPut;
@@ -45,8 +57,13 @@ public:
         state = PCM_SLOT_EMPTY;
         dsd_data = nullptr;
         dsd_samples = 0;
+        dsd_input = nullptr;
+        dsd_stride = 1;
         pcm_data = nullptr;
         pcm_samples = 0;
+        pcm_out = nullptr;
+        pcm_stride = 0;
+        pcm_format = PCM_FORMAT_FLOAT;
         converter = nullptr;
     }
 };
@@ -60,9 +77,12 @@ public:
     ~DSDPCMConverterEngine();
     float get_delay();
     bool is_convert_called();
-    int init(int channels, int framerate, int dsd_samplerate, int pcm_samplerate);
+    int init(int channels, int framerate, int dsd_samplerate, int pcm_samplerate, bool conv_fp64 = true, int conv_type = DSDPCM_CONV_MULTISTAGE);
+    void set_affinity(const cpu_set_t* cpus, int count);
+    void set_pcm_format(int pcm_format);
+    int get_pcm_sample_size();
     int free();
-    int convert(uint8_t* dsd_data, int dsd_samples, float* pcm_data);
+    int convert(uint8_t* dsd_data, int dsd_samples, void* pcm_data);
 
 private:
 
@@ -72,14 +92,19 @@ private:
     int pcm_samplerate;
     float conv_delay;
     bool conv_fp64;
+    int conv_type;
     bool conv_called;
-    DSDPCMFilterSetup fltSetup_fp64;
-    DSDPCMConverterSlot* convSlots_fp64;
+    int pcm_format;
+    DSDPCMConverterSlot<float>* convSlots_fp32;
+    DSDPCMConverterSlot<double>* convSlots_fp64;
     uint8_t swap_bits[256];
-
-    DSDPCMConverterSlot* init_slots(DSDPCMFilterSetup& fltSetup);
-    void free_slots(DSDPCMConverterSlot* convSlots);
-    int convert(DSDPCMConverterSlot* convSlots, uint8_t* dsd_data, int dsd_samples, float* pcm_data);
-    int convertL(DSDPCMConverterSlot* convSlots, uint8_t* dsd_data, int dsd_samples);
-    int convertR(DSDPCMConverterSlot* convSlots, float* pcm_data);
+    std::vector<cpu_set_t> thread_cpus; // CPUs of the channel threads, channel ch runs on entry ch % size
+
+    template<typename real_t> DSDPCMConverterSlot<real_t>* init_slots();
+    template<typename real_t> void reset_slots(DSDPCMConverterSlot<real_t>* convSlots);
+    template<typename real_t> void free_slots(DSDPCMConverterSlot<real_t>* convSlots);
+    template<typename real_t> int convert(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples, void* pcm_data);
+    template<typename real_t> int convertL(DSDPCMConverterSlot<real_t>* convSlots, uint8_t* dsd_data, int dsd_samples);
+    template<typename real_t> int convertR(DSDPCMConverterSlot<real_t>* convSlots, void* pcm_data);
+    template<typename real_t> void set_output(DSDPCMConverterSlot<real_t>* slot, int ch, void* pcm_data);
 };
@@ -22,214 +22,274 @@
 
 #include "dsd_pcm_converter.h"
 
-class DSDPCMConverterMultistage : public DSDPCMConverter
+template<typename real_t>
+class DSDPCMConverterMultistage : public DSDPCMConverter<real_t>
 {
 };
 
-class DSDPCMConverterMultistage_x512 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x512 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
-    PCMPCMFir pcm_fir2a;
-    PCMPCMFir pcm_fir2b;
-    PCMPCMFir pcm_fir2c;
-    PCMPCMFir pcm_fir2d;
-    PCMPCMFir pcm_fir3;
+    DSDPCMFir<real_t> dsd_fir1;
+    PCMPCMFir<real_t> pcm_fir2a;
+    PCMPCMFir<real_t> pcm_fir2b;
+    PCMPCMFir<real_t> pcm_fir2c;
+    PCMPCMFir<real_t> pcm_fir2d;
+    PCMPCMFir<real_t> pcm_fir3;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
     {
-        alloc_pcm_temp1(dsd_samples / 2);
-        alloc_pcm_temp2(dsd_samples / 4);
-        dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-        pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir2d.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-        delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+        this->alloc_pcm_temp1(dsd_samples / 2);
+        this->alloc_pcm_temp2(dsd_samples / 4);
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_16_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_16_length(), 16, dsd_samples);
+        pcm_fir2a.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir2b.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir2c.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir2d.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir3.init(DSDPCMFilterSetup<real_t>::get_fir3_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir3_2_length(), 2);
+        this->delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    void reset()
+    {
+        dsd_fir1.reset();
+        pcm_fir2a.reset();
+        pcm_fir2b.reset();
+        pcm_fir2c.reset();
+        pcm_fir2d.reset();
+        pcm_fir3.reset();
+    }
+
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-        pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-        pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir2d.run(pcm_temp2, pcm_temp1, pcm_samples);
-        pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples, dsd_stride);
+        pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+        pcm_samples = pcm_fir2c.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir2d.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+        pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 
         return pcm_samples;
     }
 };
 
-class DSDPCMConverterMultistage_x256 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x256 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
-    PCMPCMFir pcm_fir2a;
-    PCMPCMFir pcm_fir2b;
-    PCMPCMFir pcm_fir2c;
-    PCMPCMFir pcm_fir3;
+    DSDPCMFir<real_t> dsd_fir1;
+    PCMPCMFir<real_t> pcm_fir2a;
+    PCMPCMFir<real_t> pcm_fir2b;
+    PCMPCMFir<real_t> pcm_fir2c;
+    PCMPCMFir<real_t> pcm_fir3;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
+    {
+        this->alloc_pcm_temp1(dsd_samples / 2);
+        this->alloc_pcm_temp2(dsd_samples / 4);
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_16_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_16_length(), 16, dsd_samples);
+        pcm_fir2a.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir2b.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir2c.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir3.init(DSDPCMFilterSetup<real_t>::get_fir3_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir3_2_length(), 2);
+        this->delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+    }
+
+    void reset()
     {
-        alloc_pcm_temp1(dsd_samples / 2);
-        alloc_pcm_temp2(dsd_samples / 4);
-        dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-        pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir2c.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-        delay = (((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir2c.get_decimation() + pcm_fir2c.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+        dsd_fir1.reset();
+        pcm_fir2a.reset();
+        pcm_fir2b.reset();
+        pcm_fir2c.reset();
+        pcm_fir3.reset();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-        pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-        pcm_samples = pcm_fir2c.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples, dsd_stride);
+        pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+        pcm_samples = pcm_fir2c.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 
         return pcm_samples;
     }
 };
 
-class DSDPCMConverterMultistage_x128 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x128 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
-    PCMPCMFir pcm_fir2a;
-    PCMPCMFir pcm_fir2b;
-    PCMPCMFir pcm_fir3;
+    DSDPCMFir<real_t> dsd_fir1;
+    PCMPCMFir<real_t> pcm_fir2a;
+    PCMPCMFir<real_t> pcm_fir2b;
+    PCMPCMFir<real_t> pcm_fir3;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
     {
-        alloc_pcm_temp1(dsd_samples / 2);
-        alloc_pcm_temp2(dsd_samples / 4);
-        dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-        pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir2b.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-        delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+        this->alloc_pcm_temp1(dsd_samples / 2);
+        this->alloc_pcm_temp2(dsd_samples / 4);
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_16_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_16_length(), 16, dsd_samples);
+        pcm_fir2a.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir2b.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir3.init(DSDPCMFilterSetup<real_t>::get_fir3_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir3_2_length(), 2);
+        this->delay = ((dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir2b.get_decimation() + pcm_fir2b.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    void reset()
+    {
+        dsd_fir1.reset();
+        pcm_fir2a.reset();
+        pcm_fir2b.reset();
+        pcm_fir3.reset();
+    }
+
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-        pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir2b.run(pcm_temp2, pcm_temp1, pcm_samples);
-        pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples, dsd_stride);
+        pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir2b.run(this->pcm_temp2, this->pcm_temp1, pcm_samples);
+        pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 
         return pcm_samples;
     }
 };
 
-class DSDPCMConverterMultistage_x64 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x64 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
-    PCMPCMFir pcm_fir2a;
-    PCMPCMFir pcm_fir3;
+    DSDPCMFir<real_t> dsd_fir1;
+    PCMPCMFir<real_t> pcm_fir2a;
+    PCMPCMFir<real_t> pcm_fir3;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
     {
-        alloc_pcm_temp1(dsd_samples / 2);
-        alloc_pcm_temp2(dsd_samples / 4);
-        dsd_fir1.init(flt_setup.get_fir1_16_ctables(), flt_setup.get_fir1_16_length(), 16);
-        pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-        delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+        this->alloc_pcm_temp1(dsd_samples / 2);
+        this->alloc_pcm_temp2(dsd_samples / 4);
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_16_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_16_length(), 16, dsd_samples);
+        pcm_fir2a.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir3.init(DSDPCMFilterSetup<real_t>::get_fir3_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir3_2_length(), 2);
+        this->delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    void reset()
+    {
+        dsd_fir1.reset();
+        pcm_fir2a.reset();
+        pcm_fir3.reset();
+    }
+
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-        pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples, dsd_stride);
+        pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 
         return pcm_samples;
     }
 };
 
-class DSDPCMConverterMultistage_x32 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x32 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
-    PCMPCMFir pcm_fir2a;
-    PCMPCMFir pcm_fir3;
+    DSDPCMFir<real_t> dsd_fir1;
+    PCMPCMFir<real_t> pcm_fir2a;
+    PCMPCMFir<real_t> pcm_fir3;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
     {
-        alloc_pcm_temp1(dsd_samples);
-        alloc_pcm_temp2(dsd_samples / 2);
-        dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-        pcm_fir2a.init(flt_setup.get_fir2_2_coefs(), flt_setup.get_fir2_2_length(), 2);
-        pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-        delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+        this->alloc_pcm_temp1(dsd_samples);
+        this->alloc_pcm_temp2(dsd_samples / 2);
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_8_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_8_length(), 8, dsd_samples);
+        pcm_fir2a.init(DSDPCMFilterSetup<real_t>::get_fir2_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir2_2_length(), 2);
+        pcm_fir3.init(DSDPCMFilterSetup<real_t>::get_fir3_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir3_2_length(), 2);
+        this->delay = (dsd_fir1.get_delay() / pcm_fir2a.get_decimation() + pcm_fir2a.get_delay()) / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    void reset()
+    {
+        dsd_fir1.reset();
+        pcm_fir2a.reset();
+        pcm_fir3.reset();
+    }
+
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-        pcm_samples = pcm_fir2a.run(pcm_temp1, pcm_temp2, pcm_samples);
-        pcm_samples = pcm_fir3.run(pcm_temp2, pcm_data, pcm_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples, dsd_stride);
+        pcm_samples = pcm_fir2a.run(this->pcm_temp1, this->pcm_temp2, pcm_samples);
+        pcm_samples = pcm_fir3.run(this->pcm_temp2, pcm_data, pcm_samples);
 
         return pcm_samples;
     }
 };
 
-class DSDPCMConverterMultistage_x16 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x16 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
-    PCMPCMFir pcm_fir3;
+    DSDPCMFir<real_t> dsd_fir1;
+    PCMPCMFir<real_t> pcm_fir3;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
+    {
+        this->alloc_pcm_temp1(dsd_samples);
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_8_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_8_length(), 8, dsd_samples);
+        pcm_fir3.init(DSDPCMFilterSetup<real_t>::get_fir3_2_coefs(), DSDPCMFilterSetup<real_t>::get_fir3_2_length(), 2);
+        this->delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+    }
+
+    void reset()
     {
-        alloc_pcm_temp1(dsd_samples);
-        dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-        pcm_fir3.init(flt_setup.get_fir3_2_coefs(), flt_setup.get_fir3_2_length(), 2);
-        delay = dsd_fir1.get_delay() / pcm_fir3.get_decimation() + pcm_fir3.get_delay();
+        dsd_fir1.reset();
+        pcm_fir3.reset();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_temp1, dsd_samples);
-        pcm_samples = pcm_fir3.run(pcm_temp1, pcm_data, pcm_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, this->pcm_temp1, dsd_samples, dsd_stride);
+        pcm_samples = pcm_fir3.run(this->pcm_temp1, pcm_data, pcm_samples);
 
         return pcm_samples;
     }
 };
 
-class DSDPCMConverterMultistage_x8 : public DSDPCMConverterMultistage
+template<typename real_t>
+class DSDPCMConverterMultistage_x8 : public DSDPCMConverterMultistage<real_t>
 {
-    DSDPCMFir dsd_fir1;
+    DSDPCMFir<real_t> dsd_fir1;
 
 public:
 
-    void init(DSDPCMFilterSetup& flt_setup, int dsd_samples)
+    void init(int dsd_samples)
+    {
+        dsd_fir1.init(DSDPCMFilterSetup<real_t>::get_fir1_8_ctables(), DSDPCMFilterSetup<real_t>::get_fir1_8_length(), 8, dsd_samples);
+        this->delay = dsd_fir1.get_delay();
+    }
+
+    void reset()
     {
-        dsd_fir1.init(flt_setup.get_fir1_8_ctables(), flt_setup.get_fir1_8_length(), 8);
-        delay = dsd_fir1.get_delay();
+        dsd_fir1.reset();
     }
 
-    int convert(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    int convert(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples;
-        pcm_samples = dsd_fir1.run(dsd_data, pcm_data, dsd_samples);
+        pcm_samples = dsd_fir1.run(dsd_data, pcm_data, dsd_samples, dsd_stride);
 
         return pcm_samples;
     }
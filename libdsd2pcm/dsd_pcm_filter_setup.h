@@ -23,160 +23,148 @@
 #include "dsd_pcm_constants.h"
 #include "dsd_pcm_util.h"
 
-class DSDPCMFilterSetup
+// Compile-time generation of the filter tables. A table is built by a constexpr function from an index pack
+// 0..N-1, which is made in log2(N) steps so the large DSD tables stay within the template depth limit.
+template<int... I>
+struct dsdpcm_indices
 {
-    using ctable_t = double[256];
-    ctable_t* dsd_fir1_8_ctables;
-    ctable_t* dsd_fir1_16_ctables;
-    ctable_t* dsd_fir1_64_ctables;
-    double* pcm_fir2_2_coefs;
-    double* pcm_fir3_2_coefs;
+};
 
-public:
+template<typename S, bool odd>
+struct dsdpcm_indices_twice;
 
-    DSDPCMFilterSetup()
-    {
-        dsd_fir1_8_ctables = nullptr;
-        dsd_fir1_16_ctables = nullptr;
-        dsd_fir1_64_ctables = nullptr;
-        pcm_fir2_2_coefs = nullptr;
-        pcm_fir3_2_coefs = nullptr;
-    }
+template<int... I>
+struct dsdpcm_indices_twice<dsdpcm_indices<I...>, false>
+{
+    typedef dsdpcm_indices<I..., (int(sizeof...(I)) + I)...> type;
+};
 
-    ~DSDPCMFilterSetup()
-    {
+template<int... I>
+struct dsdpcm_indices_twice<dsdpcm_indices<I...>, true>
+{
+    typedef dsdpcm_indices<I..., (int(sizeof...(I)) + I)..., 2 * int(sizeof...(I))> type;
+};
 
-        DSDPCMUtil::mem_free(pcm_fir2_2_coefs);
-        DSDPCMUtil::mem_free(pcm_fir3_2_coefs);
-    }
+template<int N>
+struct dsdpcm_make_indices
+{
+    typedef typename dsdpcm_indices_twice<typename dsdpcm_make_indices<N / 2>::type, N % 2 == 1>::type type;
+};
+
+template<>
+struct dsdpcm_make_indices<0>
+{
+    typedef dsdpcm_indices<> type;
+};
+
+template<typename real_t, int ctables>
+struct dsdpcm_ctables_t
+{
+    alignas(MEM_ALIGN) real_t ctable[ctables][256];
+};
+
+template<typename real_t, int length>
+struct dsdpcm_coefs_t
+{
+    alignas(MEM_ALIGN) real_t coefs[length];
+};
+
+// Sum of the taps of byte ct under the bits of i, a set bit for +1 and a clear one for -1, added in the
+// same order as they used to be at run time
+constexpr double dsdpcm_ctable_sum(const double* fir_coefs, int fir_length, int ct, int i, int j, int k, double cvalue)
+{
+    return j < k ? dsdpcm_ctable_sum(fir_coefs, fir_length, ct, i, j + 1, k, cvalue + (((i >> (7 - j)) & 1) * 2 - 1) * fir_coefs[fir_length - 1 - (ct * 8 + j)]) : cvalue;
+}
+
+constexpr double dsdpcm_ctable_value(const double* fir_coefs, int fir_length, double fir_gain, int ct, int i)
+{
+    return dsdpcm_ctable_sum(fir_coefs, fir_length, ct, i, 0, fir_length - ct * 8 > 8 ? 8 : fir_length - ct * 8, 0.0) * fir_gain;
+}
+
+template<typename real_t, int ctables, int... I>
+constexpr dsdpcm_ctables_t<real_t, ctables> dsdpcm_make_ctables(const double* fir_coefs, int fir_length, double fir_gain, dsdpcm_indices<I...>)
+{
+    return {{(real_t)dsdpcm_ctable_value(fir_coefs, fir_length, fir_gain, I / 256, I % 256)...}};
+}
 
-    static const double NORM_I(const int scale = 0)
+template<typename real_t, int length, int... I>
+constexpr dsdpcm_coefs_t<real_t, length> dsdpcm_make_coefs(const double* fir_coefs, double fir_gain, dsdpcm_indices<I...>)
+{
+    return {{(real_t)(fir_coefs[length - 1 - I] * fir_gain)...}};
+}
+
+// Filter tables in the precision of the converters using them, real_t is float or double. The tables are
+// generated by the compiler into read-only storage, so there is nothing to build at run time and the pages
+// are shared by every engine of the process and by every process running the same binary.
+template<typename real_t>
+class DSDPCMFilterSetup
+{
+    using ctable_t = real_t[256];
+
+public:
+
+    static constexpr double NORM_I(const int scale = 0)
     {
         return (double)1 / (double)((unsigned int)1 << (31 - scale));
     }
 
-    ctable_t* get_fir1_8_ctables()
+    static const ctable_t* get_fir1_8_ctables()
     {
-        if (!dsd_fir1_8_ctables)
-        {
-            dsd_fir1_8_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_8_LENGTH) * sizeof(ctable_t));
-            set_ctables(DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH, NORM_I(3), dsd_fir1_8_ctables);
-        }
+        static constexpr dsdpcm_ctables_t<real_t, CTABLES(DSDFIR1_8_LENGTH)> ctables = dsdpcm_make_ctables<real_t, CTABLES(DSDFIR1_8_LENGTH)>(DSDFIR1_8_COEFS, DSDFIR1_8_LENGTH, NORM_I(3), typename dsdpcm_make_indices<CTABLES(DSDFIR1_8_LENGTH) * 256>::type());
 
-        return dsd_fir1_8_ctables;
+        return ctables.ctable;
     }
 
-    int get_fir1_8_length()
+    static int get_fir1_8_length()
     {
         return DSDFIR1_8_LENGTH;
     }
 
-    ctable_t* get_fir1_16_ctables()
+    static const ctable_t* get_fir1_16_ctables()
     {
-        if (!dsd_fir1_16_ctables)
-        {
-            dsd_fir1_16_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_16_LENGTH) * sizeof(ctable_t));
-            set_ctables(DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH, NORM_I(3), dsd_fir1_16_ctables);
-        }
+        static constexpr dsdpcm_ctables_t<real_t, CTABLES(DSDFIR1_16_LENGTH)> ctables = dsdpcm_make_ctables<real_t, CTABLES(DSDFIR1_16_LENGTH)>(DSDFIR1_16_COEFS, DSDFIR1_16_LENGTH, NORM_I(3), typename dsdpcm_make_indices<CTABLES(DSDFIR1_16_LENGTH) * 256>::type());
 
-        return dsd_fir1_16_ctables;
+        return ctables.ctable;
     }
 
-    int get_fir1_16_length()
+    static int get_fir1_16_length()
     {
         return DSDFIR1_16_LENGTH;
     }
 
-    ctable_t* get_fir1_64_ctables()
+    static const ctable_t* get_fir1_64_ctables()
     {
-        if (!dsd_fir1_64_ctables)
-        {
-            dsd_fir1_64_ctables = (ctable_t*)DSDPCMUtil::mem_alloc(CTABLES(DSDFIR1_64_LENGTH) * sizeof(ctable_t));
-            set_ctables(DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH, NORM_I(), dsd_fir1_64_ctables);
-        }
+        static constexpr dsdpcm_ctables_t<real_t, CTABLES(DSDFIR1_64_LENGTH)> ctables = dsdpcm_make_ctables<real_t, CTABLES(DSDFIR1_64_LENGTH)>(DSDFIR1_64_COEFS, DSDFIR1_64_LENGTH, NORM_I(), typename dsdpcm_make_indices<CTABLES(DSDFIR1_64_LENGTH) * 256>::type());
 
-        return dsd_fir1_64_ctables;
+        return ctables.ctable;
     }
 
-
-    int get_fir1_64_length()
+    static int get_fir1_64_length()
     {
         return DSDFIR1_64_LENGTH;
     }
 
-    double* get_fir2_2_coefs()
+    static const real_t* get_fir2_2_coefs()
     {
-        if (!pcm_fir2_2_coefs)
-        {
-            pcm_fir2_2_coefs = (double*)DSDPCMUtil::mem_alloc(PCMFIR2_2_LENGTH * sizeof(double));
-            set_coefs(PCMFIR2_2_COEFS, PCMFIR2_2_LENGTH, NORM_I(), pcm_fir2_2_coefs);
-        }
+        static constexpr dsdpcm_coefs_t<real_t, PCMFIR2_2_LENGTH> coefs = dsdpcm_make_coefs<real_t, PCMFIR2_2_LENGTH>(PCMFIR2_2_COEFS, NORM_I(), typename dsdpcm_make_indices<PCMFIR2_2_LENGTH>::type());
 
-        return pcm_fir2_2_coefs;
+        return coefs.coefs;
     }
 
-    int get_fir2_2_length()
+    static int get_fir2_2_length()
     {
         return PCMFIR2_2_LENGTH;
     }
 
-    double* get_fir3_2_coefs()
+    static const real_t* get_fir3_2_coefs()
     {
-        if (!pcm_fir3_2_coefs)
-        {
-            pcm_fir3_2_coefs = (double*)DSDPCMUtil::mem_alloc(PCMFIR3_2_LENGTH * sizeof(double));
-            set_coefs(PCMFIR3_2_COEFS, PCMFIR3_2_LENGTH, NORM_I(), pcm_fir3_2_coefs);
-        }
+        static constexpr dsdpcm_coefs_t<real_t, PCMFIR3_2_LENGTH> coefs = dsdpcm_make_coefs<real_t, PCMFIR3_2_LENGTH>(PCMFIR3_2_COEFS, NORM_I(), typename dsdpcm_make_indices<PCMFIR3_2_LENGTH>::type());
 
-        return pcm_fir3_2_coefs;
+        return coefs.coefs;
     }
 
-    int get_fir3_2_length()
+    static int get_fir3_2_length()
     {
         return PCMFIR3_2_LENGTH;
     }
-
-private:
-
-    int set_ctables(const double* fir_coefs, const int fir_length, const double fir_gain, ctable_t* out_ctables)
-    {
-        int ctables = CTABLES(fir_length);
-
-        for (int ct = 0; ct < ctables; ct++)
-        {
-            int k = fir_length - ct * 8;
-
-            if (k > 8)
-            {
-                k = 8;
-            }
-
-            if (k < 0)
-            {
-                k = 0;
-            }
-
-            for (int i = 0; i < 256; i++)
-            {
-                double cvalue = 0.0;
-
-                for (int j = 0; j < k; j++)
-                {
-                    cvalue += (((i >> (7 - j)) & 1) * 2 - 1) * fir_coefs[fir_length - 1 - (ct * 8 + j)];
-                }
-
-                out_ctables[ct][i] = (double)(cvalue * fir_gain);
-            }
-        }
-
-        return ctables;
-    }
-
-    void set_coefs(const double* fir_coefs, const int fir_length, const double fir_gain, double* out_coefs)
-    {
-        for (int i = 0; i < fir_length; i++)
-        {
-            out_coefs[i] = (double)(fir_coefs[fir_length - 1 - i] * fir_gain);
-        }
-    }
 };
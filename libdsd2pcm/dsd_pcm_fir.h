@@ -20,15 +20,19 @@
 
 #pragma once
 
+// Filters a whole frame at a time against a linear history: fir_buffer holds the last fir_length bytes of
+// the previous frames followed by the bytes of the current one, so the window of every output sample is
+// contiguous and only the tail is carried over to the next frame.
+template<typename real_t>
 class DSDPCMFir
 {
-    using ctable_t = double[256];
-    ctable_t* fir_ctables;
+    using ctable_t = real_t[256];
+    const ctable_t* fir_ctables;
     int fir_order;
     int fir_length;
     int decimation;
     uint8_t*  fir_buffer;
-    int fir_index;
+    int fir_buffer_size;
 
 public:
 
@@ -39,7 +43,7 @@ public:
         fir_length = 0;
         decimation = 0;
         fir_buffer = nullptr;
-        fir_index = 0;
+        fir_buffer_size = 0;
     }
 
     ~DSDPCMFir()
@@ -47,16 +51,21 @@ public:
         free();
     }
 
-    void init(ctable_t* fir_ctables, int fir_length, int decimation)
+    // dsd_samples sizes the buffer for frames of up to that many bytes, larger frames grow it
+    void init(const ctable_t* fir_ctables, int fir_length, int decimation, int dsd_samples = 0)
     {
         this->fir_ctables = fir_ctables;
         this->fir_order = fir_length - 1;
         this->fir_length = CTABLES(fir_length);
         this->decimation = decimation / 8;
-        int buf_size = 2 * this->fir_length * sizeof(uint8_t);
-        this->fir_buffer = (uint8_t*)DSDPCMUtil::mem_alloc(buf_size);
-        memset(this->fir_buffer, DSD_SILENCE_BYTE, buf_size);
-        fir_index = 0;
+        free();
+        alloc(this->fir_length + dsd_samples);
+        reset();
+    }
+
+    void reset()
+    {
+        memset(fir_buffer, DSD_SILENCE_BYTE, fir_length * sizeof(uint8_t));
     }
 
     void free()
@@ -65,6 +74,7 @@ public:
         {
             DSDPCMUtil::mem_free(fir_buffer);
             fir_buffer = nullptr;
+            fir_buffer_size = 0;
         }
     }
 
@@ -72,32 +82,94 @@ public:
         return decimation;
     }
 
+    // A filter whose length is not a whole number of bytes leaves the newest bits of the window unused,
+    // which adds to the delay
     float get_delay()
     {
-        return (float)fir_order / 2 / 8 / decimation;
+        return ((float)fir_order / 2 + fir_length * 8 - (fir_order + 1)) / 8 / decimation;
     }
 
-    int run(uint8_t* dsd_data, double* pcm_data, int dsd_samples)
+    // Reads dsd_samples bytes of one channel, dsd_stride bytes apart, straight from an interleaved frame
+    int run(uint8_t* dsd_data, real_t* pcm_data, int dsd_samples, int dsd_stride = 1)
     {
         int pcm_samples = dsd_samples / decimation;
+        int frame_size = pcm_samples * decimation;
+
+        if (fir_length + frame_size > fir_buffer_size)
+        {
+            alloc(fir_length + frame_size);
+        }
+
+        uint8_t* frame = fir_buffer + fir_length;
+
+        for (int i = 0; i < frame_size; i++)
+        {
+            frame[i] = dsd_data[i * dsd_stride];
+        }
+
+        // The window of output sample n starts (n + 1) * decimation bytes into the buffer
+        run_block(fir_buffer + decimation, pcm_data, pcm_samples);
+
+        memmove(fir_buffer, fir_buffer + frame_size, fir_length);
+
+        return pcm_samples;
+    }
+
+private:
+
+    // Keeps the history when growing
+    void alloc(int size)
+    {
+        uint8_t* buffer = (uint8_t*)DSDPCMUtil::mem_alloc(size * sizeof(uint8_t));
+
+        if (fir_buffer)
+        {
+            memcpy(buffer, fir_buffer, fir_length);
+            DSDPCMUtil::mem_free(fir_buffer);
+        }
+
+        fir_buffer = buffer;
+        fir_buffer_size = size;
+    }
+
+    // Four output samples per pass: their table lookups are independent, so they overlap instead of waiting on
+    // one chain of adds. Each sample is still summed in tap order.
+    void run_block(const uint8_t* window, real_t* pcm_data, int pcm_samples)
+    {
+        int sample = 0;
 
-        for (int sample = 0; sample < pcm_samples; sample++)
+        for (; sample + 4 <= pcm_samples; sample += 4, window += 4 * decimation)
         {
-            for (int i = 0; i < decimation; i++)
+            const uint8_t* w0 = window;
+            const uint8_t* w1 = w0 + decimation;
+            const uint8_t* w2 = w1 + decimation;
+            const uint8_t* w3 = w2 + decimation;
+            real_t acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+
+            for (int j = 0; j < fir_length; j++)
             {
-                fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(dsd_data++);
-                fir_index = fir_index + 1;
-                fir_index = fir_index % fir_length;
+                acc0 += fir_ctables[j][w0[j]];
+                acc1 += fir_ctables[j][w1[j]];
+                acc2 += fir_ctables[j][w2[j]];
+                acc3 += fir_ctables[j][w3[j]];
             }
 
-            pcm_data[sample] = (double)0;
+            pcm_data[sample + 0] = acc0;
+            pcm_data[sample + 1] = acc1;
+            pcm_data[sample + 2] = acc2;
+            pcm_data[sample + 3] = acc3;
+        }
+
+        for (; sample < pcm_samples; sample++, window += decimation)
+        {
+            real_t acc = 0;
 
             for (int j = 0; j < fir_length; j++)
             {
-                pcm_data[sample] += fir_ctables[j][fir_buffer[fir_index + j]];
+                acc += fir_ctables[j][window[j]];
             }
-        }
 
-        return pcm_samples;
+            pcm_data[sample] = acc;
+        }
     }
 };
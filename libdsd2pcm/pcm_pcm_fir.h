@@ -20,14 +20,208 @@
 
 #pragma once
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define PCMPCM_FIR_SIMD
+#endif
+
+// Kernels of a decimating half-band filter, out[s] = center * even[s + M / 2 + 1] + sum(coefs[k] * (odd[s + k] + odd[s + M - k])).
+// Every instruction set does the same operations per sample in the same order (no fused multiply-add), so all
+// of them give the same output. The vector ones do two vectors of outputs per pass, so two chains of adds overlap.
+// The translation units that use them are built with -ffp-contract=off, so no multiply and add gets fused.
+template<typename real_t>
+inline void pcmpcm_hb_scalar(const real_t* even, const real_t* odd, const real_t* coefs, int pairs, real_t center, int order, real_t* out, int out_samples)
+{
+    for (int sample = 0; sample < out_samples; sample++)
+    {
+        real_t acc = center * even[sample + order / 2 + 1];
+
+        for (int k = 0; k < pairs; k++)
+        {
+            acc += coefs[k] * (odd[sample + k] + odd[sample + order - k]);
+        }
+
+        out[sample] = acc;
+    }
+}
+
+#ifdef PCMPCM_FIR_SIMD
+__attribute__((target("sse2"))) inline void pcmpcm_hb_sse2(const double* even, const double* odd, const double* coefs, int pairs, double center, int order, double* out, int out_samples)
+{
+    int sample = 0;
+    const __m128d c = _mm_set1_pd(center);
+
+    for (; sample + 4 <= out_samples; sample += 4)
+    {
+        __m128d acc0 = _mm_mul_pd(c, _mm_loadu_pd(even + sample + order / 2 + 1));
+        __m128d acc1 = _mm_mul_pd(c, _mm_loadu_pd(even + sample + order / 2 + 3));
+
+        for (int k = 0; k < pairs; k++)
+        {
+            const __m128d h = _mm_set1_pd(coefs[k]);
+            const double* a = odd + sample + k;
+            const double* b = odd + sample + order - k;
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(h, _mm_add_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(h, _mm_add_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2))));
+        }
+
+        _mm_storeu_pd(out + sample, acc0);
+        _mm_storeu_pd(out + sample + 2, acc1);
+    }
+
+    pcmpcm_hb_scalar<double>(even + sample, odd + sample, coefs, pairs, center, order, out + sample, out_samples - sample);
+}
+
+__attribute__((target("sse2"))) inline void pcmpcm_hb_sse2(const float* even, const float* odd, const float* coefs, int pairs, float center, int order, float* out, int out_samples)
+{
+    int sample = 0;
+    const __m128 c = _mm_set1_ps(center);
+
+    for (; sample + 8 <= out_samples; sample += 8)
+    {
+        __m128 acc0 = _mm_mul_ps(c, _mm_loadu_ps(even + sample + order / 2 + 1));
+        __m128 acc1 = _mm_mul_ps(c, _mm_loadu_ps(even + sample + order / 2 + 5));
+
+        for (int k = 0; k < pairs; k++)
+        {
+            const __m128 h = _mm_set1_ps(coefs[k]);
+            const float* a = odd + sample + k;
+            const float* b = odd + sample + order - k;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(h, _mm_add_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(h, _mm_add_ps(_mm_loadu_ps(a + 4), _mm_loadu_ps(b + 4))));
+        }
+
+        _mm_storeu_ps(out + sample, acc0);
+        _mm_storeu_ps(out + sample + 4, acc1);
+    }
+
+    pcmpcm_hb_scalar<float>(even + sample, odd + sample, coefs, pairs, center, order, out + sample, out_samples - sample);
+}
+
+__attribute__((target("avx2"))) inline void pcmpcm_hb_avx2(const double* even, const double* odd, const double* coefs, int pairs, double center, int order, double* out, int out_samples)
+{
+    int sample = 0;
+    const __m256d c = _mm256_set1_pd(center);
+
+    for (; sample + 8 <= out_samples; sample += 8)
+    {
+        __m256d acc0 = _mm256_mul_pd(c, _mm256_loadu_pd(even + sample + order / 2 + 1));
+        __m256d acc1 = _mm256_mul_pd(c, _mm256_loadu_pd(even + sample + order / 2 + 5));
+
+        for (int k = 0; k < pairs; k++)
+        {
+            const __m256d h = _mm256_set1_pd(coefs[k]);
+            const double* a = odd + sample + k;
+            const double* b = odd + sample + order - k;
+            acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(h, _mm256_add_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b))));
+            acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(h, _mm256_add_pd(_mm256_loadu_pd(a + 4), _mm256_loadu_pd(b + 4))));
+        }
+
+        _mm256_storeu_pd(out + sample, acc0);
+        _mm256_storeu_pd(out + sample + 4, acc1);
+    }
+
+    pcmpcm_hb_sse2(even + sample, odd + sample, coefs, pairs, center, order, out + sample, out_samples - sample);
+}
+
+__attribute__((target("avx2"))) inline void pcmpcm_hb_avx2(const float* even, const float* odd, const float* coefs, int pairs, float center, int order, float* out, int out_samples)
+{
+    int sample = 0;
+    const __m256 c = _mm256_set1_ps(center);
+
+    for (; sample + 16 <= out_samples; sample += 16)
+    {
+        __m256 acc0 = _mm256_mul_ps(c, _mm256_loadu_ps(even + sample + order / 2 + 1));
+        __m256 acc1 = _mm256_mul_ps(c, _mm256_loadu_ps(even + sample + order / 2 + 9));
+
+        for (int k = 0; k < pairs; k++)
+        {
+            const __m256 h = _mm256_set1_ps(coefs[k]);
+            const float* a = odd + sample + k;
+            const float* b = odd + sample + order - k;
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(h, _mm256_add_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(h, _mm256_add_ps(_mm256_loadu_ps(a + 8), _mm256_loadu_ps(b + 8))));
+        }
+
+        _mm256_storeu_ps(out + sample, acc0);
+        _mm256_storeu_ps(out + sample + 8, acc1);
+    }
+
+    pcmpcm_hb_sse2(even + sample, odd + sample, coefs, pairs, center, order, out + sample, out_samples - sample);
+}
+
+__attribute__((target("avx512f"))) inline void pcmpcm_hb_avx512(const double* even, const double* odd, const double* coefs, int pairs, double center, int order, double* out, int out_samples)
+{
+    int sample = 0;
+    const __m512d c = _mm512_set1_pd(center);
+
+    for (; sample + 16 <= out_samples; sample += 16)
+    {
+        __m512d acc0 = _mm512_mul_pd(c, _mm512_loadu_pd(even + sample + order / 2 + 1));
+        __m512d acc1 = _mm512_mul_pd(c, _mm512_loadu_pd(even + sample + order / 2 + 9));
+
+        for (int k = 0; k < pairs; k++)
+        {
+            const __m512d h = _mm512_set1_pd(coefs[k]);
+            const double* a = odd + sample + k;
+            const double* b = odd + sample + order - k;
+            acc0 = _mm512_add_pd(acc0, _mm512_mul_pd(h, _mm512_add_pd(_mm512_loadu_pd(a), _mm512_loadu_pd(b))));
+            acc1 = _mm512_add_pd(acc1, _mm512_mul_pd(h, _mm512_add_pd(_mm512_loadu_pd(a + 8), _mm512_loadu_pd(b + 8))));
+        }
+
+        _mm512_storeu_pd(out + sample, acc0);
+        _mm512_storeu_pd(out + sample + 8, acc1);
+    }
+
+    pcmpcm_hb_avx2(even + sample, odd + sample, coefs, pairs, center, order, out + sample, out_samples - sample);
+}
+
+__attribute__((target("avx512f"))) inline void pcmpcm_hb_avx512(const float* even, const float* odd, const float* coefs, int pairs, float center, int order, float* out, int out_samples)
+{
+    int sample = 0;
+    const __m512 c = _mm512_set1_ps(center);
+
+    for (; sample + 32 <= out_samples; sample += 32)
+    {
+        __m512 acc0 = _mm512_mul_ps(c, _mm512_loadu_ps(even + sample + order / 2 + 1));
+        __m512 acc1 = _mm512_mul_ps(c, _mm512_loadu_ps(even + sample + order / 2 + 17));
+
+        for (int k = 0; k < pairs; k++)
+        {
+            const __m512 h = _mm512_set1_ps(coefs[k]);
+            const float* a = odd + sample + k;
+            const float* b = odd + sample + order - k;
+            acc0 = _mm512_add_ps(acc0, _mm512_mul_ps(h, _mm512_add_ps(_mm512_loadu_ps(a), _mm512_loadu_ps(b))));
+            acc1 = _mm512_add_ps(acc1, _mm512_mul_ps(h, _mm512_add_ps(_mm512_loadu_ps(a + 16), _mm512_loadu_ps(b + 16))));
+        }
+
+        _mm512_storeu_ps(out + sample, acc0);
+        _mm512_storeu_ps(out + sample + 16, acc1);
+    }
+
+    pcmpcm_hb_avx2(even + sample, odd + sample, coefs, pairs, center, order, out + sample, out_samples - sample);
+}
+#endif
+
+template<typename real_t>
 class PCMPCMFir
 {
-    double* fir_coefs;
+    typedef void (*kernel_t)(const real_t* even, const real_t* odd, const real_t* coefs, int pairs, real_t center, int order, real_t* out, int out_samples);
+
+    const real_t* fir_coefs;
     int fir_order;
     int fir_length;
     int decimation;
-    double* fir_buffer;
-    int fir_index;
+    real_t* fir_buffer; // History of fir_length samples followed by the block being filtered
+    int fir_buffer_size;
+    bool half_band;
+    int hb_order; // M, the center tap
+    int hb_pairs; // Nonzero taps on either side of the center
+    real_t* hb_coefs; // Coefficient of each folded pair, nearest to the oldest sample first
+    real_t hb_center;
+    real_t* hb_even; // Samples at even positions, a history of M followed by the block
+    real_t* hb_odd; // Samples at odd positions, the same layout
+    int hb_size;
 
 public:
 
@@ -38,7 +232,15 @@ public:
         fir_length = 0;
         decimation = 0;
         fir_buffer = nullptr;
-        fir_index = 0;
+        fir_buffer_size = 0;
+        half_band = false;
+        hb_order = 0;
+        hb_pairs = 0;
+        hb_coefs = nullptr;
+        hb_center = 0;
+        hb_even = nullptr;
+        hb_odd = nullptr;
+        hb_size = 0;
     }
 
     ~PCMPCMFir()
@@ -46,27 +248,60 @@ public:
         free();
     }
 
-    void init(double* fir_coefs, int fir_length, int decimation)
+    void init(const real_t* fir_coefs, int fir_length, int decimation)
     {
+        free();
         this->fir_coefs = fir_coefs;
         this->fir_order = fir_length - 1;
         this->fir_length = fir_length;
         this->decimation = decimation;
-        int buf_size = 2 * this->fir_length * sizeof(double);
-        this->fir_buffer = (double*)DSDPCMUtil::mem_alloc(buf_size);
-        memset(this->fir_buffer, 0, buf_size);
-        fir_index = 0;
+        half_band = is_half_band();
+
+        if (half_band)
+        {
+            hb_order = fir_order / 2;
+            hb_pairs = (hb_order + 1) / 2;
+            hb_center = fir_coefs[hb_order];
+            hb_coefs = (real_t*)DSDPCMUtil::mem_alloc(hb_pairs * sizeof(real_t));
+
+            for (int k = 0; k < hb_pairs; k++)
+            {
+                hb_coefs[k] = fir_coefs[2 * k];
+            }
+        }
+
+        reset();
     }
 
-    void free()
+    void reset()
     {
-        if (fir_buffer)
+        if (half_band)
         {
-            DSDPCMUtil::mem_free(fir_buffer);
-            fir_buffer = nullptr;
+            alloc_half_band(0);
+            memset(hb_even, 0, hb_order * sizeof(real_t));
+            memset(hb_odd, 0, hb_order * sizeof(real_t));
+        }
+        else
+        {
+            alloc_buffer(0);
+            memset(fir_buffer, 0, fir_length * sizeof(real_t));
         }
     }
 
+    void free()
+    {
+        DSDPCMUtil::mem_free(fir_buffer);
+        fir_buffer = nullptr;
+        fir_buffer_size = 0;
+        DSDPCMUtil::mem_free(hb_coefs);
+        hb_coefs = nullptr;
+        DSDPCMUtil::mem_free(hb_even);
+        hb_even = nullptr;
+        DSDPCMUtil::mem_free(hb_odd);
+        hb_odd = nullptr;
+        hb_size = 0;
+    }
+
     int get_decimation()
     {
         return decimation;
@@ -77,27 +312,151 @@ public:
         return (float)fir_order / 2 / decimation;
     }
 
-    int run(double* pcm_data, double* out_data, int pcm_samples)
+    int run(real_t* pcm_data, real_t* out_data, int pcm_samples)
     {
         int out_samples = pcm_samples / decimation;
 
-        for (int sample = 0; sample < out_samples; sample++)
+        if (half_band)
         {
-            for (int i = 0; i < decimation; i++)
+            run_half_band(pcm_data, out_data, out_samples);
+        }
+        else
+        {
+            run_direct(pcm_data, out_data, out_samples);
+        }
+
+        return out_samples;
+    }
+
+private:
+
+    // Decimating by 2 with a symmetric filter of 4n + 3 taps whose every other tap (counting from the center) is zero
+    bool is_half_band()
+    {
+        int center = fir_order / 2;
+
+        if (decimation != 2 || fir_length % 4 != 3)
+        {
+            return false;
+        }
+
+        for (int j = 0; j < fir_length; j++)
+        {
+            if (fir_coefs[j] != fir_coefs[fir_order - j] || (j != center && (j - center) % 2 == 0 && fir_coefs[j] != 0))
             {
-                fir_buffer[fir_index + fir_length] = fir_buffer[fir_index] = *(pcm_data++);
-                fir_index = fir_index + 1;
-                fir_index = fir_index % fir_length;
+                return false;
             }
+        }
+
+        return true;
+    }
+
+    // The window of output n covers inputs 2n - 2M + 1 to 2n + 1 (the oldest 2M in the history). Split in even and
+    // odd positions, the nonzero taps all fall on odd ones and the center on an even one.
+    void run_half_band(const real_t* pcm_data, real_t* out_data, int out_samples)
+    {
+        static const kernel_t kernel = select_kernel();
+
+        alloc_half_band(out_samples);
+
+        for (int i = 0; i < out_samples; i++)
+        {
+            hb_even[hb_order + i] = pcm_data[2 * i];
+            hb_odd[hb_order + i] = pcm_data[2 * i + 1];
+        }
+
+        kernel(hb_even, hb_odd, hb_coefs, hb_pairs, hb_center, hb_order, out_data, out_samples);
+        memmove(hb_even, hb_even + out_samples, hb_order * sizeof(real_t));
+        memmove(hb_odd, hb_odd + out_samples, hb_order * sizeof(real_t));
+    }
+
+    void run_direct(const real_t* pcm_data, real_t* out_data, int out_samples)
+    {
+        int block_size = out_samples * decimation;
 
-            out_data[sample] = (double)0;
+        alloc_buffer(block_size);
+        memcpy(fir_buffer + fir_length, pcm_data, block_size * sizeof(real_t));
+
+        for (int sample = 0; sample < out_samples; sample++)
+        {
+            const real_t* window = fir_buffer + (sample + 1) * decimation;
+            real_t acc = 0;
 
             for (int j = 0; j < fir_length; j++)
             {
-                out_data[sample] += fir_coefs[j] * fir_buffer[fir_index + j];
+                acc += fir_coefs[j] * window[j];
             }
+
+            out_data[sample] = acc;
         }
 
-        return out_samples;
+        memmove(fir_buffer, fir_buffer + block_size, fir_length * sizeof(real_t));
+    }
+
+    // Makes room for a block of that many outputs after the history, keeping the history
+    void alloc_half_band(int out_samples)
+    {
+        if (hb_even && hb_order + out_samples <= hb_size)
+        {
+            return;
+        }
+
+        int size = hb_order + out_samples;
+        real_t* even = (real_t*)DSDPCMUtil::mem_alloc(size * sizeof(real_t));
+        real_t* odd = (real_t*)DSDPCMUtil::mem_alloc(size * sizeof(real_t));
+
+        if (hb_even)
+        {
+            memcpy(even, hb_even, hb_order * sizeof(real_t));
+            memcpy(odd, hb_odd, hb_order * sizeof(real_t));
+            DSDPCMUtil::mem_free(hb_even);
+            DSDPCMUtil::mem_free(hb_odd);
+        }
+
+        hb_even = even;
+        hb_odd = odd;
+        hb_size = size;
+    }
+
+    void alloc_buffer(int block_size)
+    {
+        if (fir_buffer && fir_length + block_size <= fir_buffer_size)
+        {
+            return;
+        }
+
+        int size = fir_length + block_size;
+        real_t* buffer = (real_t*)DSDPCMUtil::mem_alloc(size * sizeof(real_t));
+
+        if (fir_buffer)
+        {
+            memcpy(buffer, fir_buffer, fir_length * sizeof(real_t));
+            DSDPCMUtil::mem_free(fir_buffer);
+        }
+
+        fir_buffer = buffer;
+        fir_buffer_size = size;
+    }
+
+    // The overload of each kernel for real_t
+    static kernel_t select_kernel()
+    {
+#ifdef PCMPCM_FIR_SIMD
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return pcmpcm_hb_avx512;
+        }
+
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return pcmpcm_hb_avx2;
+        }
+
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return pcmpcm_hb_sse2;
+        }
+#endif
+        return pcmpcm_hb_scalar<real_t>;
     }
 };
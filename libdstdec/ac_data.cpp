@@ -64,26 +64,6 @@
 
 #include "ac_data.h"
 
-#define PBITS AC_BITS //number of bits for Probabilities
-#define NBITS 4 //number of overhead bits: must be at least 2! Maximum "variable shift length" is (NBITS-1)
-#define PSUM (1 << (PBITS))
-#define ABITS (PBITS + NBITS) // must be at least PBITS+2
-#define MB 0 // if (MB) print max buffer use
-#define ONE (1 << ABITS)
-#define HALF (1 << (ABITS - 1))
-
-int CACData::getPtableIndex(long PredicVal, int PtableLen)
-{
-    int j = (PredicVal > 0 ? PredicVal : -PredicVal) >> AC_QSTEP;
-
-    if (j >= PtableLen)
-    {
-        j = PtableLen - 1;
-    }
-
-    return j;
-}
-
 void CACData::decodeBit(uint8_t& b, int p, uint8_t* cb, int fs, int flush)
 {
     unsigned int ap;
@@ -164,62 +144,57 @@ void CACData::decodeBit(uint8_t& b, int p, uint8_t* cb, int fs, int flush)
     }
 }
 
-void CACData::decodeBit_Init(ADataByte* cb, int fs)
+// Load whole bytes of the arithmetic code into BitBuf; bits past the end of the code read as zero
+void CACData::fillBitBuffer()
 {
-    Init = 0;
-    A = ONE - 1;
-    C = 0;
-
-    for (cbptr = 1; cbptr <= ABITS; cbptr++)
+    while (BitCnt <= 56)
     {
-        C <<= 1;
+        uint64_t v = 0;
 
-        if (cbptr < fs)
+        if (cbnext < (cbend >> 3))
+        {
+            v = cbdata[cbnext];
+        }
+        else if (cbnext == (cbend >> 3) && (cbend & 7))
         {
-            C |= GET_BIT(cb, cbptr);
+            v = cbdata[cbnext] & ~(0xff >> (cbend & 7));
         }
+
+        BitBuf |= v << (56 - BitCnt);
+        BitCnt += 8;
+        cbnext++;
     }
 }
 
-void CACData::decodeBit_Decode(uint8_t* b, int p, ADataByte* cb, int fs)
+// Start decoding the fs bits of arithmetic code found at bit position start of cb, which is read in place
+void CACData::decodeBit_Init(const ADataByte* cb, int start, int fs)
 {
-    unsigned int ap;
-    unsigned int h;
-
-    // approximate (A * p) with "partial rounding".
-    ap = ((A >> PBITS) | ((A >> (PBITS - 1)) & 1)) * p;
-    h = A - ap;
+    const int skip = (start & 7) + 1;
 
-    if (C >= h)
-    {
-        *b = 0;
-        C -= h;
-        A = ap;
-    }
-    else
-    {
-        *b = 1;
-        A = h;
-    }
-
-    while (A < HALF)
-    {
-        A <<= 1;
-
-        // Use new flushing technique; insert zero in LSB of C if reading past the end of the arithmetic code
-        C <<= 1;
-
-        if (cbptr < fs)
-        {
-            C |= GET_BIT(cb, cbptr);
-        }
-
-        cbptr++;
-    }
+    Init = 0;
+    A = ONE - 1;
+    cbdata = cb;
+    cbstart = start;
+    cbend = start + fs;
+    cbnext = start >> 3;
+    BitBuf = 0;
+    BitCnt = 0;
+
+    fillBitBuffer();
+
+    // Skip to the start of the code; its first bit is not part of C
+    BitBuf <<= skip;
+    BitCnt -= skip;
+    C = (unsigned int)(BitBuf >> (64 - ABITS));
+    BitBuf <<= ABITS;
+    BitCnt -= ABITS;
+    cbptr = ABITS + 1;
 }
 
-void CACData::decodeBit_Flush(uint8_t* b, int p, ADataByte* cb, int fs)
+void CACData::decodeBit_Flush(uint8_t* b)
 {
+    const int fs = cbend - cbstart;
+
     Init = 1;
 
     if (cbptr < fs - 7)
@@ -232,7 +207,9 @@ void CACData::decodeBit_Flush(uint8_t* b, int p, ADataByte* cb, int fs)
 
         while ((cbptr < fs) && (*b == 1))
         {
-            if (GET_BIT(cb, cbptr) != 0)
+            const int BitNr = cbstart + cbptr;
+
+            if (GET_BIT(cbdata, BitNr) != 0)
             {
                 *b = 1;
             }
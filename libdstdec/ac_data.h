@@ -69,18 +69,85 @@
 
 class CACData
 {
+    static constexpr int PBITS = AC_BITS; //number of bits for Probabilities
+    static constexpr int NBITS = 4; //number of overhead bits: must be at least 2! Maximum "variable shift length" is (NBITS-1)
+    static constexpr int PSUM = 1 << PBITS;
+    static constexpr int ABITS = PBITS + NBITS; // must be at least PBITS+2
+    static constexpr int MB = 0; // if (MB) print max buffer use
+    static constexpr int ONE = 1 << ABITS;
+    static constexpr int HALF = 1 << (ABITS - 1);
+
     unsigned int Init;
     unsigned int C;
     unsigned int A;
     int cbptr;
+    uint64_t BitBuf; // Code bits following cbptr, MSB aligned
+    int BitCnt; // Number of valid bits in BitBuf
+    const ADataByte* cbdata; // Buffer holding the arithmetic code being decoded
+    int cbstart; // Bit position of the arithmetic code in cbdata
+    int cbend; // Bit position following the arithmetic code in cbdata
+    int cbnext; // Next byte of cbdata to load into BitBuf
+
+    void fillBitBuffer();
 
 public:
 
     int getPtableIndex(long PredicVal, int PtableLen);
     void decodeBit(uint8_t& b, int p, uint8_t* cb, int fs, int flush);
-    void decodeBit_Init(ADataByte* cb, int fs);
-    void decodeBit_Decode(uint8_t* b, int p, ADataByte* cb, int fs);
-    void decodeBit_Flush(uint8_t* b, int p, ADataByte* cb, int fs);
+    void decodeBit_Init(const ADataByte* cb, int start, int fs);
+    void decodeBit_Decode(uint8_t* b, int p);
+    void decodeBit_Flush(uint8_t* b);
 };
 
+inline int CACData::getPtableIndex(long PredicVal, int PtableLen)
+{
+    int j = (PredicVal > 0 ? PredicVal : -PredicVal) >> AC_QSTEP;
+
+    if (j >= PtableLen)
+    {
+        j = PtableLen - 1;
+    }
+
+    return j;
+}
+
+inline void CACData::decodeBit_Decode(uint8_t* b, int p)
+{
+    unsigned int ap;
+    unsigned int h;
+
+    // approximate (A * p) with "partial rounding".
+    ap = ((A >> PBITS) | ((A >> (PBITS - 1)) & 1)) * p;
+    h = A - ap;
+
+    if (C >= h)
+    {
+        *b = 0;
+        C -= h;
+        A = ap;
+    }
+    else
+    {
+        *b = 1;
+        A = h;
+    }
+
+    // Renormalise in one step: the leading zeros of A give the number of code bits to shift into C
+    if (A < HALF)
+    {
+        int n = __builtin_clz(A) - (32 - ABITS);
+
+        if (BitCnt < n)
+        {
+            fillBitBuffer();
+        }
+
+        A <<= n;
+        C = (C << n) | (unsigned int)(BitBuf >> (64 - n));
+        BitBuf <<= n;
+        BitCnt -= n;
+        cbptr += n;
+    }
+}
+
 #endif
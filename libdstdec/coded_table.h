@@ -85,7 +85,6 @@ public:
 
 class CCodedTableF : public CCodedTable
 {
-    int Data[2 * MAX_CHANNELS][(1 << SIZE_CODEDPREDORDER) * SIZE_PREDCOEF]; // FirData[FirNr][Index]
 
 public:
 
@@ -94,7 +93,6 @@ public:
 
 class CCodedTableP : public CCodedTable
 {
-    int Data[2 * MAX_CHANNELS][AC_BITS * AC_HISMAX]; // PtabData[PtabNr][Index]
 
 public:
 
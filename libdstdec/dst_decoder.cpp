@@ -64,16 +64,26 @@
 
 */
 
+#include <stdlib.h>
+#include <time.h>
 #include "ac_data.h"
 #include "frame_reader.h"
 #include "dst_decoder.h"
 
 CDSTDecoder::CDSTDecoder()
 {
+    Result.Error = DST_NOERROR;
+    Result.Stage = DST_STAGE_HEADER;
+    Result.FrameNr = 0;
+    Timing.Enabled = false;
+    Tables = nullptr;
+    LT_ICoefI = nullptr;
+    P_one = nullptr;
 }
 
 CDSTDecoder::~CDSTDecoder()
 {
+    free(Tables);
 }
 
 int CDSTDecoder::init(int channels, int fs44)
@@ -85,7 +95,34 @@ int CDSTDecoder::init(int channels, int fs44)
     FrameHdr.NrOfBitsPerCh = FrameHdr.MaxFrameLen * 8;
     FrameHdr.MaxNrOfFilters = 2 * FrameHdr.NrOfChannels;
     FrameHdr.MaxNrOfPtables = 2 * FrameHdr.NrOfChannels;
+
+    // The lookup tables and Ptables are read for every bit, keep them together on cache line boundaries and
+    // only for the filters and Ptables this channel count allows
+    const size_t ICoefISize = FrameHdr.MaxNrOfFilters * sizeof(int16_t[16][256]);
+
+    free(Tables);
+    Tables = nullptr;
+    LT_ICoefI = nullptr;
+    P_one = nullptr;
+
+    if (posix_memalign(&Tables, 64, ICoefISize + FrameHdr.MaxNrOfPtables * sizeof(int[AC_HISMAX])) != 0)
+    {
+        Tables = nullptr;
+        return DST_ERROR_MEMORY;
+    }
+
+    LT_ICoefI = (int16_t (*)[16][256])Tables;
+    P_one = (int (*)[AC_HISMAX])((uint8_t*)Tables + ICoefISize);
     FrameHdr.FrameNr = 0;
+    Timing.Frames = 0;
+    Timing.Unpack = 0.0;
+    Timing.Tables = 0.0;
+    Timing.Decode = 0.0;
+
+    for (int FilterNr = 0; FilterNr < 2 * MAX_CHANNELS; FilterNr++)
+    {
+        LT_ICoefOrder[FilterNr] = 0;
+    }
 
     return 0;
 }
@@ -114,63 +151,114 @@ Predict += FilterTable[13][ChannelStatus[13]]; \
 Predict += FilterTable[14][ChannelStatus[14]]; \
 Predict += FilterTable[15][ChannelStatus[15]];
 
-int CDSTDecoder::decode(uint8_t* DSTFrame, int frameSize, uint8_t* DSDFrame)
+// Output of the prediction filter from the 16 x 256 lookup tables built by LT_InitCoefTablesI and the
+// 128 bit channel status, read as 16 bytes
+static inline int16_t LT_RunFilter(const int16_t FilterTable[16][256], const uint64_t ChannelStatus[2])
 {
-    int rv = 0;
-    int ChNr;
-    int BitNr;
-    uint8_t ACError;
-    int NrOfBitsPerCh = FrameHdr.NrOfBitsPerCh;
-    int NrOfChannels = FrameHdr.NrOfChannels;
+    const uint8_t* const Status = (const uint8_t*)ChannelStatus;
+    int16_t Predict;
 
-    FrameHdr.FrameNr++;
-    FrameHdr.CalcNrOfBytes = frameSize / 8;
-    FrameHdr.CalcNrOfBits = FrameHdr.CalcNrOfBytes * 8;
+    LT_RUN_FILTER_I(FilterTable, Status);
 
-    // unpack DST frame: segmentation, mapping, arithmetic data
-    rv = unpack(DSTFrame, DSDFrame);
+    return Predict;
+}
 
-    if (rv == -1)
+// Decode all bits of all channels of a DST coded frame.
+// The frame is decoded in spans of bits that end at the next segment boundary (or end of the p = 0.5 bits)
+// of any channel, so within a span the filter and Ptable of every channel are fixed and looked up once.
+// Channels are decoded in the order ChNr = 0..NrOfChannels-1 for every BitNr, and the prediction of a
+// channel only depends on its own history, so with two or more channels the prediction of the next
+// channel is calculated before the arithmetic decoder resolves the current bit. This keeps the filter
+// off the critical path of the arithmetic decoder and out of the shadow of its mispredicted branches.
+static void LT_DecodeBits(CDSTDecoder& D, const int16_t ICoefI[2 * MAX_CHANNELS][16][256], CACData& AC, uint64_t LT_Status[MAX_CHANNELS][2], uint8_t* DSDFrame)
+{
+    const CFrameHeader& FrameHdr = D.FrameHdr;
+    const CSegment& FSeg = FrameHdr.FSeg;
+    const CSegment& PSeg = FrameHdr.PSeg;
+    const int NrOfBitsPerCh = FrameHdr.NrOfBitsPerCh;
+    const int NrOfChannels = FrameHdr.NrOfChannels;
+    const bool PredictAhead = NrOfChannels > 1;
+    int FSegNr[MAX_CHANNELS];
+    int PSegNr[MAX_CHANNELS];
+    const int16_t (*FilterTable[MAX_CHANNELS])[256];
+    const int* Ptable[MAX_CHANNELS];
+    int PtableLen[MAX_CHANNELS];
+    bool HalfProb[MAX_CHANNELS];
+
+    for (int ChNr = 0; ChNr < NrOfChannels; ChNr++)
     {
-        return -1;
+        FSegNr[ChNr] = 0;
+        PSegNr[ChNr] = 0;
     }
 
-    if (FrameHdr.DSTCoded == 1)
+    for (int SpanStart = 0, SpanEnd; SpanStart < NrOfBitsPerCh; SpanStart = SpanEnd)
     {
-        CACData AC;
-        int16_t LT_ICoefI[2 * MAX_CHANNELS][16][256];
-        uint8_t LT_Status[MAX_CHANNELS][16];
+        SpanEnd = NrOfBitsPerCh;
 
-        fillTable4Bit(FrameHdr.FSeg, FrameHdr.Filter4Bit);
-        fillTable4Bit(FrameHdr.PSeg, FrameHdr.Ptable4Bit);
-        LT_InitCoefTablesI(LT_ICoefI);
-        LT_InitStatus(LT_Status);
-        AC.decodeBit_Init(AData, ADataLen);
-        AC.decodeBit_Decode(&ACError, reverse7LSBs(FrameHdr.ICoefA[0][0]), AData, ADataLen);
-        dst_memset(DSDFrame, 0, (NrOfBitsPerCh * NrOfChannels + 7) / 8);
+        // Select the filter and Ptable of every channel for this span
+        for (int ChNr = 0; ChNr < NrOfChannels; ChNr++)
+        {
+            while (FSeg.SegmentEnd[ChNr][FSegNr[ChNr]] <= SpanStart)
+            {
+                FSegNr[ChNr]++;
+            }
+
+            while (PSeg.SegmentEnd[ChNr][PSegNr[ChNr]] <= SpanStart)
+            {
+                PSegNr[ChNr]++;
+            }
+
+            const int FilterNr = FSeg.Table4Segment[ChNr][FSegNr[ChNr]];
+            const int PtableNr = PSeg.Table4Segment[ChNr][PSegNr[ChNr]];
+
+            FilterTable[ChNr] = ICoefI[FilterNr];
+            Ptable[ChNr] = D.P_one[PtableNr];
+            PtableLen[ChNr] = FrameHdr.PtableLen[PtableNr];
+            HalfProb[ChNr] = FrameHdr.HalfProb[ChNr] && SpanStart < FrameHdr.NrOfHalfBits[ChNr];
+
+            SpanEnd = MIN(SpanEnd, FSeg.SegmentEnd[ChNr][FSegNr[ChNr]]);
+            SpanEnd = MIN(SpanEnd, PSeg.SegmentEnd[ChNr][PSegNr[ChNr]]);
+
+            if (HalfProb[ChNr])
+            {
+                SpanEnd = MIN(SpanEnd, FrameHdr.NrOfHalfBits[ChNr]);
+            }
+        }
+
+        // Calculate output value of the FIR filter for the first bit of the first channel
+        int16_t Predict = LT_RunFilter(FilterTable[0], LT_Status[0]);
 
-        for (BitNr = 0; BitNr < NrOfBitsPerCh; BitNr++)
+        for (int BitNr = SpanStart; BitNr < SpanEnd; BitNr++)
         {
-            for (ChNr = 0; ChNr < NrOfChannels; ChNr++)
+            for (int ChNr = 0; ChNr < NrOfChannels; ChNr++)
             {
-                int16_t Predict;
                 uint8_t Residual;
                 int16_t BitVal;
-                const int FilterNr = GET_NIBBLE(FrameHdr.Filter4Bit[ChNr], BitNr);
+                int16_t NextPredict = 0;
+                int NextChNr = ChNr + 1;
+                int NextBitNr = BitNr;
 
-                // Calculate output value of the FIR filter
-                LT_RUN_FILTER_I(LT_ICoefI[FilterNr], LT_Status[ChNr]);
+                if (NextChNr == NrOfChannels)
+                {
+                    NextChNr = 0;
+                    NextBitNr++;
+                }
+
+                // Calculate output value of the FIR filter for the next channel, it does not depend on this bit
+                if (PredictAhead && NextBitNr < SpanEnd)
+                {
+                    NextPredict = LT_RunFilter(FilterTable[NextChNr], LT_Status[NextChNr]);
+                }
 
                 // Arithmetic decode the incoming bit
-                if ((FrameHdr.HalfProb[ChNr]) && (BitNr < FrameHdr.NrOfHalfBits[ChNr]))
+                if (HalfProb[ChNr])
                 {
-                    AC.decodeBit_Decode(&Residual, AC_PROBS / 2, AData, ADataLen);
+                    AC.decodeBit_Decode(&Residual, AC_PROBS / 2);
                 }
                 else
                 {
-                    int PtableNr = GET_NIBBLE(FrameHdr.Ptable4Bit[ChNr], BitNr);
-                    int PtableIndex = AC.getPtableIndex(Predict, FrameHdr.PtableLen[PtableNr]);
-                    AC.decodeBit_Decode(&Residual, P_one[PtableNr][PtableIndex], AData, ADataLen);
+                    int PtableIndex = AC.getPtableIndex(Predict, PtableLen[ChNr]);
+                    AC.decodeBit_Decode(&Residual, Ptable[ChNr][PtableIndex]);
                 }
 
                 // Channel bit depends on the predicted bit and BitResidual[][]
@@ -179,36 +267,115 @@ int CDSTDecoder::decode(uint8_t* DSTFrame, int frameSize, uint8_t* DSDFrame)
                 // Shift the result into the correct bit position
                 DSDFrame[(BitNr >> 3) * NrOfChannels + ChNr] |= (uint8_t)(BitVal << (7 - (BitNr & 7)));
 
-                // Update filter
-                uint32_t* const st = (uint32_t*)LT_Status[ChNr];
-                st[3] = (st[3] << 1) | ((st[2] >> 31) & 1);
-                st[2] = (st[2] << 1) | ((st[1] >> 31) & 1);
-                st[1] = (st[1] << 1) | ((st[0] >> 31) & 1);
+                // Update filter: the 128 bit channel status is shifted as one unit
+                uint64_t* const st = LT_Status[ChNr];
+                st[1] = (st[1] << 1) | (st[0] >> 63);
                 st[0] = (st[0] << 1) | BitVal;
+
+                // A single channel predicts from the bit just decoded
+                if (!PredictAhead && NextBitNr < SpanEnd)
+                {
+                    NextPredict = LT_RunFilter(FilterTable[NextChNr], LT_Status[NextChNr]);
+                }
+
+                Predict = NextPredict;
             }
         }
+    }
+}
+
+// Returns DST_NOERROR or the error code, Result tells where the error was found. A frame with an error
+// leaves DSDFrame undefined, the next frame can be decoded without reinitialising the decoder.
+int CDSTDecoder::decode(uint8_t* DSTFrame, int frameSize, uint8_t* DSDFrame)
+{
+    int rv;
+    uint8_t ACError;
+    double t0 = Timing.Enabled ? getTime() : 0.0;
+    double t1 = t0;
+    int NrOfBitsPerCh = FrameHdr.NrOfBitsPerCh;
+    int NrOfChannels = FrameHdr.NrOfChannels;
+
+    FrameHdr.FrameNr++;
+    FrameHdr.CalcNrOfBytes = frameSize / 8;
+    FrameHdr.CalcNrOfBits = FrameHdr.CalcNrOfBytes * 8;
+
+    Result.Error = DST_NOERROR;
+    Result.Stage = DST_STAGE_HEADER;
+    Result.FrameNr = FrameHdr.FrameNr;
+
+    // unpack DST frame: segmentation, mapping, arithmetic data
+    rv = unpack(DSTFrame, DSDFrame);
+
+    if (rv != DST_NOERROR)
+    {
+        return rv;
+    }
+
+    if (Timing.Enabled)
+    {
+        t1 = getTime();
+        Timing.Unpack += t1 - t0;
+        t0 = t1;
+    }
+
+    if (FrameHdr.DSTCoded == 1)
+    {
+        CACData AC;
+        uint64_t LT_Status[MAX_CHANNELS][2];
+
+        LT_InitCoefTablesI();
+
+        if (Timing.Enabled)
+        {
+            t1 = getTime();
+        }
+
+        fillSegmentEnd(FrameHdr.FSeg);
+        fillSegmentEnd(FrameHdr.PSeg);
+        LT_InitStatus(LT_Status);
+        AC.decodeBit_Init(AData, ADataStart, ADataLen);
+        AC.decodeBit_Decode(&ACError, reverse7LSBs(FrameHdr.ICoefA[0][0]));
+        dst_memset(DSDFrame, 0, (NrOfBitsPerCh * NrOfChannels + 7) / 8);
+
+        LT_DecodeBits(*this, LT_ICoefI, AC, LT_Status, DSDFrame);
 
         // Flush the arithmetic decoder
-        AC.decodeBit_Flush(&ACError, 0, AData, ADataLen);
+        AC.decodeBit_Flush(&ACError);
+
+        if (Timing.Enabled)
+        {
+            Timing.Tables += t1 - t0;
+            Timing.Decode += getTime() - t1;
+        }
 
         if (ACError != 1)
         {
-            printf("ERROR: Arithmetic decoding error!");
-            rv = -1;
+            return setError(DST_ERROR_ARITHMETIC_DECODING, DST_STAGE_ARITHMETIC);
         }
     }
 
-    return rv;
+    Timing.Frames++;
+
+    return DST_NOERROR;
+}
+
+double CDSTDecoder::getTime()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
 }
 
 // Read a complete frame from the DST input stream
 int CDSTDecoder::unpack(uint8_t* DSTFrame, uint8_t* DSDFrame)
 {
     int Dummy;
-    int Ready = 0;
+    int Error;
 
-    // fill internal buffer with DSTframe
-    SD.fillBuffer(DSTFrame, FrameHdr.CalcNrOfBytes);
+    // read the DST frame in place
+    SD.setBuffer(DSTFrame, FrameHdr.CalcNrOfBytes);
 
     // interpret DST header byte
     SD.getIntUnsigned(1, FrameHdr.DSTCoded);
@@ -220,31 +387,104 @@ int CDSTDecoder::unpack(uint8_t* DSTFrame, uint8_t* DSDFrame)
 
         if (Dummy != 0)
         {
-            printf("ERROR: Illegal stuffing pattern in frame %d!\n", FrameHdr.FrameNr);
-
-            return -1;
+            return setError(DST_ERROR_STUFFING, DST_STAGE_HEADER);
         }
 
         // Read DSD data and put in output stream
         CFrameReader::readDSDFrame(SD, FrameHdr.MaxFrameLen, FrameHdr.NrOfChannels, DSDFrame);
+
+        if (SD.eof())
+        {
+            return setError(DST_ERROR_TRUNCATED, DST_STAGE_HEADER);
+        }
     }
     else
     {
-        CFrameReader::readSegmentData(SD, FrameHdr);
-        CFrameReader::readMappingData(SD, FrameHdr);
-        CFrameReader::readFilterCoefSets(SD, FrameHdr.NrOfChannels, FrameHdr, StrFilter);
-        CFrameReader::readProbabilityTables(SD, FrameHdr, StrPtable, P_one);
-        ADataLen = FrameHdr.CalcNrOfBits - SD.get_in_bitcount();
-        CFrameReader::readArithmeticCodedData(SD, ADataLen, AData);
-
-        if (ADataLen > 0 && GET_BIT(AData, 0) != 0)
+        if ((Error = CFrameReader::readSegmentData(SD, FrameHdr)) != DST_NOERROR)
+        {
+            return setError(Error, DST_STAGE_SEGMENTATION);
+        }
+
+        if ((Error = CFrameReader::readMappingData(SD, FrameHdr)) != DST_NOERROR)
+        {
+            return setError(Error, DST_STAGE_MAPPING);
+        }
+
+        if ((Error = CFrameReader::readFilterCoefSets(SD, FrameHdr.NrOfChannels, FrameHdr, StrFilter)) != DST_NOERROR)
         {
-            printf("ERROR: Illegal arithmetic code in frame %d!", FrameHdr.FrameNr);
-            return -1;
+            return setError(Error, DST_STAGE_FILTERS);
+        }
+
+        if ((Error = CFrameReader::readProbabilityTables(SD, FrameHdr, StrPtable, P_one)) != DST_NOERROR)
+        {
+            return setError(Error, DST_STAGE_PTABLES);
+        }
+
+        if (SD.eof())
+        {
+            return setError(DST_ERROR_TRUNCATED, DST_STAGE_PTABLES);
+        }
+
+        // The arithmetic coded data takes the rest of the frame and is decoded in place
+        AData = DSTFrame;
+        ADataStart = SD.get_in_bitcount();
+        ADataLen = FrameHdr.CalcNrOfBits - ADataStart;
+
+        if (ADataLen > 0 && GET_BIT(AData, ADataStart) != 0)
+        {
+            return setError(DST_ERROR_ARITHMETIC_CODE, DST_STAGE_ARITHMETIC);
         }
     }
 
-    return Ready;
+    return DST_NOERROR;
+}
+
+// Record an error of the frame being decoded and return its code
+int CDSTDecoder::setError(int Error, int Stage)
+{
+    Result.Error = Error;
+    Result.Stage = Stage;
+
+    return Error;
+}
+
+const char* CDSTDecoder::errorText(int Error)
+{
+    static const char* const Text[DST_NROF_ERRORS] =
+    {
+        "No error",
+        "Illegal stuffing pattern",
+        "Too many segments",
+        "Invalid segment resolution",
+        "Invalid segment length",
+        "Invalid table number for segment",
+        "Too many tables for this frame",
+        "Mapping does not match the segmentation",
+        "Invalid coding method",
+        "Filter coefficient out of range",
+        "Ptable entry out of range",
+        "Frame truncated",
+        "Illegal arithmetic code",
+        "Arithmetic decoding error",
+        "Out of memory"
+    };
+
+    return (Error >= 0 && Error < DST_NROF_ERRORS) ? Text[Error] : "Unknown error";
+}
+
+const char* CDSTDecoder::stageText(int Stage)
+{
+    static const char* const Text[DST_NROF_STAGES] =
+    {
+        "header",
+        "segmentation",
+        "mapping",
+        "filter coefficients",
+        "probability tables",
+        "arithmetic decoding"
+    };
+
+    return (Stage >= 0 && Stage < DST_NROF_STAGES) ? Text[Stage] : "unknown stage";
 }
 
 // Take the 7 LSBs of a number consisting of SIZE_PREDCOEF bits (2's complement), reverse the bit order and add 1 to it.
@@ -265,109 +505,73 @@ int16_t CDSTDecoder::reverse7LSBs(int16_t c)
     return reverse[(c + (1 << SIZE_PREDCOEF)) & 127];
 }
 
-// Fill an array that indicates for each bit of each channel which table number must be used
-void CDSTDecoder::fillTable4Bit(CSegment& S, uint8_t Table4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME / 2])
+// Calculate for each segment of each channel the bit position where the next segment starts; the last segment runs to the end of the frame
+void CDSTDecoder::fillSegmentEnd(CSegment& S)
 {
     int SegNr;
-    int Start;
-    int End;
-    int8_t Val;
+    long Start;
 
     for (int ChNr = 0; ChNr < FrameHdr.NrOfChannels; ChNr++)
     {
         for (SegNr = 0, Start = 0; SegNr < S.NrOfSegments[ChNr] - 1; SegNr++)
         {
-            Val = (int8_t)S.Table4Segment[ChNr][SegNr];
-            End = Start + S.Resolution * 8 * S.SegmentLen[ChNr][SegNr];
-
-            for (int BitNr = Start; BitNr < End; BitNr++)
-            {
-                uint8_t* p = (uint8_t*)&Table4Bit[ChNr][BitNr / 2];
-                int s = (BitNr & 1) << 2;
-                *p = ((uint8_t)Val << s) | (*p & (0xf0 >> s));
-            }
-
             Start += S.Resolution * 8 * S.SegmentLen[ChNr][SegNr];
+            S.SegmentEnd[ChNr][SegNr] = (int)MIN(Start, FrameHdr.NrOfBitsPerCh);
         }
 
-        Val = (int8_t)S.Table4Segment[ChNr][SegNr];
-
-        for (int BitNr = Start; BitNr < FrameHdr.NrOfBitsPerCh; BitNr++)
-        {
-            uint8_t* p = (uint8_t*)&Table4Bit[ChNr][BitNr / 2];
-            int s = (BitNr & 1) << 2;
-            *p = ((uint8_t)Val << s) | (*p & (0xf0 >> s));
-        }
+        S.SegmentEnd[ChNr][SegNr] = (int)FrameHdr.NrOfBitsPerCh;
     }
 }
 
-void CDSTDecoder::LT_InitCoefTablesI(int16_t ICoefI[2 * MAX_CHANNELS][16][256])
+// Build the lookup tables of all filters whose order or coefficients differ from the ones the cached
+// table was built for. Each 8 coefficient table is filled in Gray code order, so that every entry only
+// flips one status bit of its predecessor and costs a single addition.
+void CDSTDecoder::LT_InitCoefTablesI()
 {
-    int FilterNr, FilterLength, TableNr, k, i, j;
-
-    for (FilterNr = 0; FilterNr < FrameHdr.NrOfFilters; FilterNr++)
+    for (int FilterNr = 0; FilterNr < FrameHdr.NrOfFilters; FilterNr++)
     {
-        FilterLength = FrameHdr.PredOrder[FilterNr];
+        const int FilterLength = FrameHdr.PredOrder[FilterNr];
+        const int16_t* const ICoefA = FrameHdr.ICoefA[FilterNr];
 
-        for (TableNr = 0; TableNr < 16; TableNr++)
+        if (LT_ICoefOrder[FilterNr] == FilterLength && dst_memcmp(LT_ICoefA[FilterNr], ICoefA, FilterLength * sizeof(int16_t)) == 0)
         {
-            k = FilterLength - TableNr * 8;
+            continue;
+        }
 
-            if (k > 8)
-            {
-                k = 8;
-            }
-            else if (k < 0)
+        for (int TableNr = 0; TableNr < 16; TableNr++)
+        {
+            int16_t* const Table = LT_ICoefI[FilterNr][TableNr];
+            int Coef[8];
+            int cvalue = 0;
+
+            for (int j = 0; j < 8; j++)
             {
-                k = 0;
+                Coef[j] = (TableNr * 8 + j < FilterLength) ? ICoefA[TableNr * 8 + j] : 0;
+                cvalue -= Coef[j];
             }
 
-            for (i = 0; i < 256; i++)
-            {
-                int cvalue = 0;
+            Table[0] = (int16_t)cvalue;
 
-                for (j = 0; j < k; j++)
-                {
-                    cvalue += (((i >> j) & 1) * 2 - 1) * FrameHdr.ICoefA[FilterNr][TableNr * 8 + j];
-                }
+            for (int i = 1; i < 256; i++)
+            {
+                const int j = __builtin_ctz(i);
+                const int Gray = i ^ (i >> 1);
 
-                ICoefI[FilterNr][TableNr][i] = (int16_t)cvalue;
+                cvalue += ((Gray >> j) & 1) ? 2 * Coef[j] : -2 * Coef[j];
+                Table[Gray] = (int16_t)cvalue;
             }
         }
+
+        dst_memcpy(LT_ICoefA[FilterNr], ICoefA, FilterLength * sizeof(int16_t));
+        LT_ICoefOrder[FilterNr] = FilterLength;
     }
 }
 
-void CDSTDecoder::LT_InitStatus(uint8_t Status[MAX_CHANNELS][16])
+void CDSTDecoder::LT_InitStatus(uint64_t Status[MAX_CHANNELS][2])
 {
-    int ChNr, TableNr;
-
-    for (ChNr = 0; ChNr < FrameHdr.NrOfChannels; ChNr++)
+    for (int ChNr = 0; ChNr < FrameHdr.NrOfChannels; ChNr++)
     {
-        for (TableNr = 0; TableNr < 16; TableNr++)
-        {
-            Status[ChNr][TableNr] = 0xaa;
-        }
+        Status[ChNr][0] = 0xaaaaaaaaaaaaaaaaULL;
+        Status[ChNr][1] = 0xaaaaaaaaaaaaaaaaULL;
     }
 }
-
-int16_t CDSTDecoder::LT_RunFilterI(int16_t FilterTable[16][256], uint8_t ChannelStatus[16])
-{
-    int Predict = FilterTable[0][ChannelStatus[0]];
-    Predict += FilterTable[1][ChannelStatus[1]];
-    Predict += FilterTable[2][ChannelStatus[2]];
-    Predict += FilterTable[3][ChannelStatus[3]];
-    Predict += FilterTable[4][ChannelStatus[4]];
-    Predict += FilterTable[5][ChannelStatus[5]];
-    Predict += FilterTable[6][ChannelStatus[6]];
-    Predict += FilterTable[7][ChannelStatus[7]];
-    Predict += FilterTable[8][ChannelStatus[8]];
-    Predict += FilterTable[9][ChannelStatus[9]];
-    Predict += FilterTable[10][ChannelStatus[10]];
-    Predict += FilterTable[11][ChannelStatus[11]];
-    Predict += FilterTable[12][ChannelStatus[12]];
-    Predict += FilterTable[13][ChannelStatus[13]];
-    Predict += FilterTable[14][ChannelStatus[14]];
-    Predict += FilterTable[15][ChannelStatus[15]];
-
-    return (int16_t)Predict;
-}
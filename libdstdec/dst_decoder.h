@@ -77,27 +77,38 @@ public:
     CFrameHeader FrameHdr; // Contains frame based header information
     CCodedTableF StrFilter; // Contains FIR-coef. compression data
     CCodedTableP StrPtable; // Contains Ptable-entry compression data input stream.
-    int P_one[2 * MAX_CHANNELS][AC_HISMAX]; // Probability table for arithmetic coder
-    ADataByte AData[MAX_DSDBYTES_INFRAME * MAX_CHANNELS]; // Contains the arithmetic coded bit stream of a complete frame
+    int (*P_one)[AC_HISMAX]; // Probability table for arithmetic coder, MaxNrOfPtables rows in the aligned table block
+    const ADataByte* AData; // DST frame containing the arithmetic coded bit stream, read in place
+    int ADataStart; // Bit position of the arithmetic coded bit stream in AData[]
     int ADataLen; // Number of code bits contained in AData[]
     CStrData SD; // DST data stream
+    CDSTResult Result; // Result of the last decoded frame
+    CDSTTiming Timing; // Time spent per decoding stage, when enabled
 
     CDSTDecoder();
+    CDSTDecoder(const CDSTDecoder&) = delete;
+    CDSTDecoder& operator=(const CDSTDecoder&) = delete;
     ~CDSTDecoder();
     int init(int channels, int fs44);
     int close();
     int decode(uint8_t* DSTFrame, int frameSize, uint8_t* DSDFrame);
     int unpack(uint8_t* DSTFrame, uint8_t* DSDFrame);
+    static const char* errorText(int Error);
+    static const char* stageText(int Stage);
 
 private:
 
+    void* Tables; // 64-byte aligned block holding LT_ICoefI[] followed by P_one[], allocated by init()
+    int16_t (*LT_ICoefI)[16][256]; // Prediction filter lookup tables, MaxNrOfFilters filters kept across frames
+    int LT_ICoefOrder[2 * MAX_CHANNELS]; // PredOrder[] each lookup table was built for (0 = not built)
+    int16_t LT_ICoefA[2 * MAX_CHANNELS][1 << SIZE_CODEDPREDORDER]; // ICoefA[] each lookup table was built for
+
+    int setError(int Error, int Stage);
+    double getTime();
     int16_t reverse7LSBs(int16_t c);
-    void fillTable4Bit(CSegment& S, uint8_t Table4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME / 2]);
-    void LT_InitCoefTablesI(int16_t ICoefI[2 * MAX_CHANNELS][16][256]);
-    void LT_InitCoefTablesU(uint16_t ICoefU[2 * MAX_CHANNELS][16][256]);
-    void LT_InitStatus(uint8_t Status[MAX_CHANNELS][16]);
-    int16_t LT_RunFilterI(int16_t FilterTable[16][256], uint8_t ChannelStatus[16]);
-    int16_t LT_RunFilterU(uint16_t FilterTable[16][256], uint8_t ChannelStatus[16]);
+    void fillSegmentEnd(CSegment& S);
+    void LT_InitCoefTablesI();
+    void LT_InitStatus(uint64_t Status[MAX_CHANNELS][2]);
 };
 
 #endif
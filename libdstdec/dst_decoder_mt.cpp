@@ -18,118 +18,93 @@
     along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
 */
 
+#include <sched.h>
+#include <algorithm>
+#include <chrono>
 #include "dst_decoder_mt.h"
 
 #define DSD_SILENCE_BYTE 0x69
 
-void* DSTDecoderThread(void* threadarg)
+// Runs on a pool worker
+void frame_slot_t::run()
 {
-    frame_slot_t* frame_slot = (frame_slot_t*)threadarg;
+    decoder_context_t* context = owner->acquire_context();
 
-    while (1)
-    {
-        pthread_mutex_lock(&frame_slot->hMutex);
-
-        while (frame_slot->state != SLOT_LOADED && frame_slot->state != SLOT_TERMINATING)
-        {
-            pthread_cond_wait(&frame_slot->hEventPut, &frame_slot->hMutex);
-        }
-
-        if (frame_slot->state == SLOT_TERMINATING)
-        {
-            frame_slot->dsd_data = nullptr;
-            frame_slot->dst_size = 0;
-            pthread_mutex_unlock(&frame_slot->hMutex);
-            return 0;
-        }
-
-        frame_slot->state = SLOT_RUNNING;
-        pthread_mutex_unlock(&frame_slot->hMutex);
-
-        bool bError = false;
-
-        try
-        {
-            frame_slot->D.decode(frame_slot->dst_data, frame_slot->dst_size * 8, frame_slot->dsd_data);
-        }
-        catch (...)
-        {
-            bError = true;
-            frame_slot->D.close();
-            frame_slot->D.init(frame_slot->channel_count, frame_slot->samplerate / 44100);
-        }
+    // A failed frame is reported through the slot state, the decoder itself is ready for the next frame
+    bool bError = context->D.decode(dst_data, dst_size * 8, dsd_data) != DST_NOERROR;
 
-        pthread_mutex_lock(&frame_slot->hMutex);
-        frame_slot->state = bError ? SLOT_READY_WITH_ERROR : SLOT_READY;
-        pthread_cond_signal(&frame_slot->hEventGet);
-        pthread_mutex_unlock(&frame_slot->hMutex);
-    }
+    result = context->D.Result;
+    owner->release_context(context);
+    state.store(bError ? SLOT_READY_WITH_ERROR : SLOT_READY);
 
-    return 0;
+    // Last access to the slot, the caller may free it once this is seen
+    pool_refs.fetch_sub(1);
 }
 
-dst_decoder_t::dst_decoder_t(int threads)
+// threads sizes the shared pool when it does not exist yet, frames is the pipeline depth (default: threads)
+dst_decoder_t::dst_decoder_t(int threads, int frames)
 {
-    thread_count = threads;
-
-    frame_slots = new frame_slot_t[thread_count];
+    pool = dst_pool_t::shared(threads);
+    frame_count = frames > 0 ? frames : threads;
+    context_count = std::min(frame_count, pool->get_worker_count());
+    frame_slots = new frame_slot_t[frame_count];
+    contexts = new decoder_context_t[context_count];
 
-    if (!frame_slots)
+    for (int i = 0; i < frame_count; i++)
     {
-        thread_count = 0;
+        frame_slots[i].owner = this;
     }
 
     channel_count = 0;
     samplerate = 0;
     framerate = 0;
     slot_nr = 0;
+    head_nr = 0;
+    frames_in_flight = 0;
+    frame_nr = 0;
+    node = -1;
+    logger = nullptr;
+    logger_context = nullptr;
 }
 
 dst_decoder_t::~dst_decoder_t()
 {
-    for (int i = 0; i < thread_count; i++)
+    for (int i = 0; i < frame_count; i++)
     {
-        frame_slot_t* frame_slot = &frame_slots[i];
+        // Let a frame still queued or being decoded finish before its slot goes away
+        while (frame_slots[i].pool_refs.load() > 0)
+        {
+            sched_yield();
+        }
+    }
 
-        // Release worker (decoding) thread for exit
-        pthread_mutex_lock(&frame_slot->hMutex);
-        frame_slot->state = SLOT_TERMINATING;
-        frame_slot->D.close();
-        pthread_cond_signal(&frame_slot->hEventPut);
-        pthread_mutex_unlock(&frame_slot->hMutex);
-
-        // Wait until worker (decoding) thread exit
-        pthread_join(frame_slot->hThread, NULL);
-        pthread_cond_destroy(&frame_slot->hEventGet);
-        pthread_cond_destroy(&frame_slot->hEventPut);
-        pthread_mutex_destroy(&frame_slot->hMutex);
+    for (int i = 0; i < context_count; i++)
+    {
+        contexts[i].D.close();
     }
 
+    delete[] contexts;
     delete[] frame_slots;
 }
 
 int dst_decoder_t::init(int channel_count, int samplerate, int framerate)
 {
-    for (int i = 0; i < thread_count; i++)
+    for (int i = 0; i < context_count; i++)
     {
-        frame_slot_t* frame_slot = &frame_slots[i];
-
-        if (frame_slot->D.init(channel_count, (samplerate / 44100) / (framerate / 75)) == 0)
-        {
-            frame_slot->channel_count = channel_count;
-            frame_slot->samplerate = samplerate;
-            frame_slot->framerate = framerate;
-            frame_slot->dsd_size = (size_t)(samplerate / 8 / framerate * channel_count);
-            pthread_mutex_init(&frame_slot->hMutex, NULL);
-            pthread_cond_init(&frame_slot->hEventGet, NULL);
-            pthread_cond_init(&frame_slot->hEventPut, NULL);
-        }
-        else
+        if (contexts[i].D.init(channel_count, (samplerate / 44100) / (framerate / 75)) != 0)
         {
             return -1;
         }
+    }
+
+    for (int i = 0; i < frame_count; i++)
+    {
+        frame_slot_t* frame_slot = &frame_slots[i];
 
-        pthread_create(&frame_slot->hThread, NULL, DSTDecoderThread, frame_slot);
+        frame_slot->channel_count = channel_count;
+        frame_slot->samplerate = samplerate;
+        frame_slot->framerate = framerate;
+        frame_slot->dsd_size = (size_t)(samplerate / 8 / framerate * channel_count);
     }
 
     this->channel_count = channel_count;
@@ -140,65 +115,200 @@ int dst_decoder_t::init(int channel_count, int samplerate, int framerate)
     return 0;
 }
 
+// Queues the frame in the slot the caller filled (slot_nr) and hands back the oldest decoded frame, if any.
+// Frames finishing out of order wait in their slots, decode() only blocks on the oldest one when no slot is
+// left for the next frame or when draining (dst_size == 0); otherwise it returns *dsd_size == 0 at once.
 int dst_decoder_t::decode(uint8_t* dst_data, size_t dst_size, uint8_t** dsd_data, size_t* dsd_size)
 {
-    // Get current slot
-    frame_slot_t* frame_slot = &frame_slots[slot_nr];
-
-    // Allocate encoded frame into the slot
-    frame_slot->dsd_data = *dsd_data;
-    frame_slot->dst_data = dst_data;
-    frame_slot->dst_size = dst_size;
-    frame_slot->frame_nr = frame_nr;
+    dst_frame_t frame;
 
-    // Release worker (decoding) thread on the loaded slot
     if (dst_size > 0)
     {
-        pthread_mutex_lock(&frame_slot->hMutex);
-        frame_slot->state = SLOT_LOADED;
-        pthread_cond_signal(&frame_slot->hEventPut);
-        pthread_mutex_unlock(&frame_slot->hMutex);
+        frame.dst_data = dst_data;
+        frame.dst_size = dst_size;
+        frame.dsd_data = *dsd_data;
+        submit(&frame, 1);
+    }
+
+    *dsd_data = nullptr;
+    *dsd_size = 0;
+
+    if (receive(&frame, 1, dst_size == 0 || frames_in_flight == frame_count) > 0)
+    {
+        *dsd_data = frame.dsd_data;
+        *dsd_size = frame.dsd_size;
     }
-    else
+
+    return 0;
+}
+
+// Queues as many of the frames as there are free slots, without blocking. Returns the number queued,
+// the rest can be submitted again after receiving.
+int dst_decoder_t::submit(const dst_frame_t* frames, int count)
+{
+    int queued = 0;
+
+    while (queued < count && frames_in_flight < frame_count)
     {
-        frame_slot->state = SLOT_EMPTY;
+        const dst_frame_t* frame = &frames[queued];
+        frame_slot_t* frame_slot = &frame_slots[slot_nr];
+
+        frame_slot->dsd_data = frame->dsd_data;
+        frame_slot->dst_data = frame->dst_data;
+        frame_slot->dst_size = frame->dst_size;
+        frame_slot->user_data = frame->user_data;
+        frame_slot->frame_nr = frame_nr++;
+
+        // Queue the loaded slot on the pool
+        frame_slot->state.store(SLOT_LOADED);
+        frame_slot->pool_refs.fetch_add(1);
+        pool->submit(frame_slot, node);
+
+        slot_nr = (slot_nr + 1) % frame_count;
+        frames_in_flight++;
+        queued++;
     }
 
-    // Advance to the next slot
-    slot_nr = (slot_nr + 1) % thread_count;
-    frame_slot = &frame_slots[slot_nr];
+    return queued;
+}
+
+// Hands back up to count decoded frames in stream order. Frames finishing out of order wait in their slots.
+// With wait set, blocks until the oldest frame is done (if any is in flight). Returns the number of frames.
+int dst_decoder_t::receive(dst_frame_t* frames, int count, bool wait)
+{
+    int received = 0;
 
-    // Dump decoded frame
-    if (frame_slot->state != SLOT_EMPTY)
+    while (received < count && frames_in_flight > 0)
     {
-        pthread_mutex_lock(&frame_slot->hMutex);
+        frame_slot_t* frame_slot = &frame_slots[head_nr];
+        int state = frame_slot->state.load();
 
-        while (frame_slot->state != SLOT_READY)
+        if (state == SLOT_LOADED)
         {
-            pthread_cond_wait(&frame_slot->hEventGet, &frame_slot->hMutex);
+            if (!wait || received > 0)
+            {
+                break;
+            }
+
+            // Head-of-line blocking: the caller has nothing else to do until the oldest frame is done
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+            state = frame_slot->state.wait([](int s) { return s != SLOT_LOADED; });
+            stats.hol_waits++;
+            stats.hol_wait_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
         }
 
-        pthread_mutex_unlock(&frame_slot->hMutex);
+        receive_slot(frame_slot, state, &frames[received]);
+        received++;
     }
 
-    switch (frame_slot->state)
+    return received;
+}
+
+// Blocks until every frame in flight is decoded and hands back up to count of them, in stream order
+int dst_decoder_t::drain(dst_frame_t* frames, int count)
+{
+    int received = 0;
+
+    while (received < count && frames_in_flight > 0)
     {
-        case SLOT_READY:
-            *dsd_data = frame_slot->dsd_data;
-            *dsd_size = (size_t)(samplerate / 8 / framerate * channel_count);
-            break;
-        case SLOT_READY_WITH_ERROR:
-            *dsd_data = frame_slot->dsd_data;
-            *dsd_size = (size_t)(samplerate / 8 / framerate * channel_count);
-            memset(*dsd_data, DSD_SILENCE_BYTE, *dsd_size);
-            break;
-        default:
-            *dsd_data = nullptr;
-            *dsd_size = 0;
-            break;
+        received += receive(&frames[received], count - received, true);
     }
 
-    frame_nr++;
+    return received;
+}
 
-    return 0;
+// Dump decoded frame, the worker publishes it with SLOT_READY or SLOT_READY_WITH_ERROR
+void dst_decoder_t::receive_slot(frame_slot_t* frame_slot, int state, dst_frame_t* frame)
+{
+    frame->dst_data = frame_slot->dst_data;
+    frame->dst_size = frame_slot->dst_size;
+    frame->dsd_data = frame_slot->dsd_data;
+    frame->dsd_size = get_dsd_size();
+    frame->user_data = frame_slot->user_data;
+    frame->frame_nr = frame_slot->frame_nr;
+    frame->error = DST_NOERROR;
+
+    if (state == SLOT_READY_WITH_ERROR)
+    {
+        memset(frame->dsd_data, DSD_SILENCE_BYTE, frame->dsd_size);
+
+        // A decoder context only sees some of the frames, so report the stream frame number
+        stats.last_error = frame_slot->result;
+        stats.last_error.FrameNr = frame_slot->frame_nr;
+        stats.errors++;
+        frame->error = stats.last_error.Error;
+
+        if (stats.last_error.Error > DST_NOERROR && stats.last_error.Error < DST_NROF_ERRORS)
+        {
+            stats.error_count[stats.last_error.Error]++;
+        }
+
+        if (logger)
+        {
+            logger(logger_context, stats.last_error);
+        }
+    }
+
+    frame_slot->state.store(SLOT_EMPTY);
+    head_nr = (head_nr + 1) % frame_count;
+    frames_in_flight--;
+    stats.frames++;
+}
+
+void dst_decoder_t::set_logger(dst_logger_t logger, void* context)
+{
+    this->logger = logger;
+    this->logger_context = context;
+}
+
+// Keeps the stream's frames on the workers of one node of the pool (see dst_pool_t::set_placement), so they
+// decode next to the thread that reads and converts the stream
+void dst_decoder_t::set_node(int node)
+{
+    this->node = node;
+}
+
+const dst_stats_t& dst_decoder_t::get_stats() const
+{
+    return stats;
+}
+
+int dst_decoder_t::get_frame_count() const
+{
+    return frame_count;
+}
+
+int dst_decoder_t::get_frames_in_flight() const
+{
+    return frames_in_flight;
+}
+
+size_t dst_decoder_t::get_dsd_size() const
+{
+    return (size_t)(samplerate / 8 / framerate * channel_count);
+}
+
+// Runs on a pool worker. At most context_count frames of the stream run at once, so a context is always free.
+decoder_context_t* dst_decoder_t::acquire_context()
+{
+    while (1)
+    {
+        for (int i = 0; i < context_count; i++)
+        {
+            bool busy = false;
+
+            if (!contexts[i].busy.load() && contexts[i].busy.compare_exchange_strong(busy, true))
+            {
+                return &contexts[i];
+            }
+        }
+
+        dst_cpu_relax();
+    }
+}
+
+void dst_decoder_t::release_context(decoder_context_t* context)
+{
+    context->busy.store(false);
 }
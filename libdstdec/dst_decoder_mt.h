@@ -21,61 +21,153 @@
 #ifndef _DST_DECODER_H_INCLUDED
 #define _DST_DECODER_H_INCLUDED
 
-#include <pthread.h>
 #include "dst_decoder.h"
+#include "dst_pool.h"
 
-enum slot_state_t {SLOT_EMPTY, SLOT_LOADED, SLOT_RUNNING, SLOT_READY, SLOT_READY_WITH_ERROR, SLOT_TERMINATING};
+enum slot_state_t {SLOT_EMPTY, SLOT_LOADED, SLOT_READY, SLOT_READY_WITH_ERROR};
 
-class frame_slot_t
+// Receives every frame that failed to decode, in stream order, on the thread calling dst_decoder_t::decode
+typedef void (*dst_logger_t)(void* context, const CDSTResult& result);
+
+class dst_stats_t
+{
+    public:
+
+        uint32_t frames; // Frames returned by decode()
+        uint32_t errors; // Frames that failed to decode and were replaced by silence
+        uint32_t error_count[DST_NROF_ERRORS]; // Failed frames by error code
+        CDSTResult last_error; // Most recent failure
+        uint32_t hol_waits; // Calls to decode() that blocked on the oldest frame in flight
+        double hol_wait_time; // Seconds decode() spent blocked on the oldest frame in flight
+
+        dst_stats_t()
+        {
+            frames = 0;
+            errors = 0;
+            hol_waits = 0;
+            hol_wait_time = 0.0;
+            memset(error_count, 0, sizeof(error_count));
+            last_error.Error = DST_NOERROR;
+            last_error.Stage = DST_STAGE_HEADER;
+            last_error.FrameNr = 0;
+        }
+};
+
+// One frame of the batch interface. The caller fills in dst_data, dst_size and dsd_data (a buffer of
+// dst_decoder_t::get_dsd_size() bytes) and keeps both buffers valid until the frame is received back.
+class dst_frame_t
 {
     public:
 
-        volatile int state;
+        uint8_t* dst_data;
+        size_t dst_size;
+        uint8_t* dsd_data;
+        void* user_data; // Handed back unchanged
+        size_t dsd_size; // Set when received
+        uint32_t frame_nr; // Set when received, the position of the frame in the stream
+        int error; // Set when received, DST_NOERROR or the DST_ERROR_* that turned the frame into silence
+
+        dst_frame_t()
+        {
+            dst_data = nullptr;
+            dst_size = 0;
+            dsd_data = nullptr;
+            user_data = nullptr;
+            dsd_size = 0;
+            frame_nr = 0;
+            error = DST_NOERROR;
+        }
+};
+
+class dst_decoder_t;
+
+// A DST decoder that a worker borrows for one frame
+class decoder_context_t
+{
+    public:
+
+        std::atomic<bool> busy;
+        CDSTDecoder D;
+
+        decoder_context_t() : busy(false)
+        {
+        }
+};
+
+class frame_slot_t : public dst_task_t
+{
+    public:
+
+        dst_futex_t state; // slot_state_t, the caller publishes SLOT_LOADED and the worker SLOT_READY*
+        std::atomic<int> pool_refs; // Submissions the pool has not finished with, run() may still touch the slot
         int frame_nr;
         uint8_t* dsd_data;
         int dsd_size;
         uint8_t* dst_data;
         int dst_size;
+        void* user_data;
         int channel_count;
         int samplerate;
         int framerate;
-        pthread_t hThread;
-        pthread_cond_t hEventGet;
-        pthread_cond_t hEventPut;
-        pthread_mutex_t hMutex;
-        CDSTDecoder D;
+        dst_decoder_t* owner;
+        CDSTResult result; // Copied from the decoder context, which goes back to the stream after the frame
 
-        frame_slot_t()
+        frame_slot_t() : state(SLOT_EMPTY), pool_refs(0)
         {
-            state = SLOT_EMPTY;
+            owner = nullptr;
             dsd_data = nullptr;
             dsd_size = 0;
             dst_data = nullptr;
             dst_size = 0;
+            user_data = nullptr;
             channel_count = 0;
             samplerate = 0;
             framerate = 0;
             frame_nr = 0;
         }
+
+        void run();
 };
 
 class dst_decoder_t
 {
+    dst_pool_t* pool;
     frame_slot_t* frame_slots;
-    int thread_count;
+    int frame_count; // Slots, a ring of the frames in flight
+    int head_nr; // Slot of the oldest frame in flight
+    int frames_in_flight; // Frames submitted and not yet handed back
+    decoder_context_t* contexts;
+    int context_count; // No more frames of the stream can run at once than the pool has workers
     int channel_count;
     int samplerate;
     int framerate;
     uint32_t frame_nr;
+    int node; // NUMA node of the pool whose workers decode the stream, -1 for any
+    dst_stats_t stats;
+    dst_logger_t logger;
+    void* logger_context;
+
+    void receive_slot(frame_slot_t* frame_slot, int state, dst_frame_t* frame);
 
 public:
 
-    int slot_nr;
+    int slot_nr; // Slot the next decode() frame goes to, for callers that keep one buffer per slot
 
-    dst_decoder_t(int threads);
+    dst_decoder_t(int threads, int frames = 0);
     ~dst_decoder_t();
     int init(int channel_count, int samplerate, int framerate);
     int decode(uint8_t* dst_data, size_t dst_size, uint8_t** dsd_data, size_t* dsd_size);
+    int submit(const dst_frame_t* frames, int count);
+    int receive(dst_frame_t* frames, int count, bool wait);
+    int drain(dst_frame_t* frames, int count);
+    int get_frames_in_flight() const;
+    size_t get_dsd_size() const;
+    void set_logger(dst_logger_t logger, void* context);
+    void set_node(int node);
+    const dst_stats_t& get_stats() const;
+    int get_frame_count() const;
+    decoder_context_t* acquire_context();
+    void release_context(decoder_context_t* context);
 };
 
 #endif
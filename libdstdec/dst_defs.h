@@ -73,11 +73,67 @@
 #define MAX(x,y) (((x) > (y)) ? (x) : (y))
 #define GET_BIT(BitBase, BitIndex) ((((unsigned char*)BitBase)[BitIndex >> 3] >> (7 - (BitIndex & 7))) & 1)
 #define GET_NIBBLE(NibbleBase, NibbleIndex) ((((unsigned char*)NibbleBase)[NibbleIndex >> 1] >> ((NibbleIndex & 1) << 2)) & 0x0f)
+#define dst_memcmp(buf1, buf2, size) ::memcmp(buf1, buf2, size)
 #define dst_memcpy(dst, src, size) ::memcpy(dst, src, size)
 #define dst_memset(dst, val, size) ::memset(dst, val, size)
 
 extern int log_printf(char* fmt, ...);
 
+// Error codes of the DST decoder
+enum
+{
+    DST_NOERROR = 0,
+    DST_ERROR_STUFFING, // Illegal stuffing pattern in a plain DSD frame
+    DST_ERROR_SEGMENT_COUNT, // Too many segments
+    DST_ERROR_SEGMENT_RESOLUTION, // Invalid segment resolution
+    DST_ERROR_SEGMENT_LENGTH, // Invalid segment length
+    DST_ERROR_TABLE_NUMBER, // Invalid table number for a segment
+    DST_ERROR_TABLE_COUNT, // Too many tables for this frame
+    DST_ERROR_MAPPING, // Mapping does not match the segmentation
+    DST_ERROR_CODING_METHOD, // Invalid filter coefficient or Ptable coding method
+    DST_ERROR_COEF_RANGE, // Filter coefficient out of range
+    DST_ERROR_PTABLE_RANGE, // Ptable entry out of range
+    DST_ERROR_TRUNCATED, // Frame ends before its header or DSD data
+    DST_ERROR_ARITHMETIC_CODE, // Illegal start of the arithmetic code
+    DST_ERROR_ARITHMETIC_DECODING, // Arithmetic decoder did not end at the end of the code
+    DST_ERROR_MEMORY, // Decoder tables could not be allocated
+    DST_NROF_ERRORS
+};
+
+// Decoding stages that can detect an error
+enum
+{
+    DST_STAGE_HEADER = 0,
+    DST_STAGE_SEGMENTATION,
+    DST_STAGE_MAPPING,
+    DST_STAGE_FILTERS,
+    DST_STAGE_PTABLES,
+    DST_STAGE_ARITHMETIC,
+    DST_NROF_STAGES
+};
+
+class CDSTResult
+{
+
+public:
+
+    int Error; // DST_NOERROR or one of DST_ERROR_*
+    int Stage; // DST_STAGE_* that detected the error
+    int FrameNr; // Frame the result belongs to
+};
+
+class CDSTTiming
+{
+
+public:
+
+    bool Enabled; // Accumulate the times below in decode()
+    int Frames; // Frames timed
+    double Unpack; // Seconds spent reading frame headers, filters and Ptables
+    double Tables; // Seconds spent building the filter lookup tables
+    double Decode; // Seconds spent setting up and running the arithmetic decoding and prediction loop
+};
+
 class CSegment
 {
 
@@ -87,6 +143,7 @@ public:
     int SegmentLen[MAX_CHANNELS][MAXNROF_SEGS]; // SegmentLen[ChNr][SegmentNr]
     int NrOfSegments[MAX_CHANNELS]; // NrOfSegments[ChNr]
     int Table4Segment[MAX_CHANNELS][MAXNROF_SEGS]; // Table4Segment[ChNr][SegmentNr]
+    int SegmentEnd[MAX_CHANNELS][MAXNROF_SEGS]; // SegmentEnd[ChNr][SegmentNr], first bit after the segment
 };
 
 class CFrameHeader
@@ -108,9 +165,7 @@ public:
     int HalfProb[MAX_CHANNELS]; // Defines per channel which probability is applied for the first PredOrder[] bits of a frame (0 = use Ptable entry, 1 = 128)
     int NrOfHalfBits[MAX_CHANNELS]; // Defines per channel how many bits at the start of each frame are optionally coded with p=0.5
     CSegment FSeg; // Contains segmentation data for filters
-    uint8_t Filter4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME / 2]; // Filter4Bit[ChNr][BitNr]
     CSegment PSeg; // Contains segmentation data for Ptables
-    uint8_t Ptable4Bit[MAX_CHANNELS][MAX_DSDBITS_INFRAME / 2]; // Ptable4Bit[ChNr][BitNr]
     int PSameSegAsF; // 1 if segmentation is equal for F and P
     int PSameMapAsF; // 1 if mapping is equal for F and P
     int FSameSegAllCh; // 1 if all channels have same Filtersegm.
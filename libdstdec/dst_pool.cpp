@@ -0,0 +1,385 @@
+/*
+    This file is part of SACD.
+
+    SACD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SACD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "dst_pool.h"
+
+int dst_pool_t::placement = DST_PLACEMENT_NONE;
+
+// Parses a sysfs CPU list such as "0-3,8-11"
+static void parse_cpulist(const char* text, cpu_set_t* set)
+{
+    CPU_ZERO(set);
+
+    while (*text)
+    {
+        char* end;
+        long first = strtol(text, &end, 10);
+        long last = first;
+
+        if (end == text)
+        {
+            break;
+        }
+
+        if (*end == '-')
+        {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+        }
+
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+        {
+            CPU_SET(cpu, set);
+        }
+
+        text = *end == ',' ? end + 1 : end;
+    }
+}
+
+static bool read_cpulist(const char* path, cpu_set_t* set)
+{
+    char text[1024];
+    FILE* file = fopen(path, "r");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    bool read = fgets(text, sizeof(text), file) != NULL;
+
+    fclose(file);
+
+    if (read)
+    {
+        parse_cpulist(text, set);
+    }
+
+    return read;
+}
+
+dst_topology_t::dst_topology_t()
+{
+    cpu_set_t allowed;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        CPU_ZERO(&allowed);
+        CPU_SET(0, &allowed);
+    }
+
+    cpu_set_t online;
+
+    if (!read_cpulist("/sys/devices/system/node/online", &online))
+    {
+        CPU_ZERO(&online);
+    }
+
+    for (int node = 0; node < CPU_SETSIZE; node++)
+    {
+        char path[64];
+        cpu_set_t set;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+        if (!CPU_ISSET(node, &online) || !read_cpulist(path, &set))
+        {
+            continue;
+        }
+
+        CPU_AND(&set, &set, &allowed);
+
+        if (CPU_COUNT(&set) > 0)
+        {
+            node_sets.push_back(set);
+        }
+    }
+
+    if (node_sets.empty())
+    {
+        node_sets.push_back(allowed);
+    }
+
+    for (size_t node = 0; node < node_sets.size(); node++)
+    {
+        std::vector<int> cpus;
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(cpu, &node_sets[node]))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+
+        node_cpus.push_back(cpus);
+    }
+}
+
+const dst_topology_t& dst_topology_t::get()
+{
+    static dst_topology_t topology;
+
+    return topology;
+}
+
+int dst_topology_t::get_node_count() const
+{
+    return (int)node_cpus.size();
+}
+
+int dst_topology_t::get_node_cpu_count(int node) const
+{
+    return (int)node_cpus[node % node_cpus.size()].size();
+}
+
+// The index-th CPU of the node, counting round the node
+int dst_topology_t::get_node_cpu(int node, int index) const
+{
+    const std::vector<int>& cpus = node_cpus[node % node_cpus.size()];
+
+    return cpus[index % cpus.size()];
+}
+
+const cpu_set_t* dst_topology_t::get_node_cpus(int node) const
+{
+    return &node_sets[node % node_sets.size()];
+}
+
+// Binds the thread to all CPUs of the node, or to its index-th CPU when index >= 0
+bool dst_topology_t::bind_thread(pthread_t thread, int node, int index) const
+{
+    cpu_set_t set;
+
+    if (index >= 0)
+    {
+        CPU_ZERO(&set);
+        CPU_SET(get_node_cpu(node, index), &set);
+    }
+    else
+    {
+        set = *get_node_cpus(node);
+    }
+
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+struct worker_arg_t
+{
+    dst_pool_t* pool;
+    int worker_nr;
+};
+
+void* dst_pool_t::worker_thread(void* threadarg)
+{
+    worker_arg_t* arg = (worker_arg_t*)threadarg;
+    dst_pool_t* pool = arg->pool;
+    int worker_nr = arg->worker_nr;
+
+    delete arg;
+
+    while (1)
+    {
+        // Read the sequence before looking for work, so a task submitted in between is not slept over
+        int seq = pool->work_seq.load();
+        dst_task_t* task = pool->take(worker_nr);
+
+        if (task)
+        {
+            task->run();
+            continue;
+        }
+
+        if (pool->terminating.load())
+        {
+            break;
+        }
+
+        pool->work_seq.wait([seq](int v) { return v != seq; });
+    }
+
+    return 0;
+}
+
+dst_pool_t::dst_pool_t(int threads, int placement) : next_worker(0), terminating(false)
+{
+    const dst_topology_t& topology = dst_topology_t::get();
+    int node_count = placement != DST_PLACEMENT_NONE ? topology.get_node_count() : 1;
+
+    worker_count = threads > 0 ? threads : 1;
+    workers = new dst_worker_t[worker_count];
+    node_workers.resize(node_count);
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        // Deal the workers to the nodes in turn, so each node has some as long as there are enough
+        workers[i].node = i % node_count;
+        node_workers[workers[i].node].push_back(i);
+    }
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        worker_arg_t* arg = new worker_arg_t;
+
+        arg->pool = this;
+        arg->worker_nr = i;
+        workers[i].thread_started = pthread_create(&workers[i].hThread, NULL, worker_thread, arg) == 0;
+
+        if (!workers[i].thread_started)
+        {
+            delete arg;
+        }
+        else if (placement == DST_PLACEMENT_NODE)
+        {
+            topology.bind_thread(workers[i].hThread, workers[i].node);
+        }
+        else if (placement == DST_PLACEMENT_CPU)
+        {
+            topology.bind_thread(workers[i].hThread, workers[i].node, i / node_count);
+        }
+    }
+}
+
+dst_pool_t::~dst_pool_t()
+{
+    terminating.store(true);
+    work_seq.add(1);
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        if (workers[i].thread_started)
+        {
+            pthread_join(workers[i].hThread, NULL);
+        }
+    }
+
+    delete[] workers;
+}
+
+// The pool of the process, created with the worker count of the first call
+dst_pool_t* dst_pool_t::shared(int threads)
+{
+    static dst_pool_t pool(threads, placement);
+
+    return &pool;
+}
+
+// Placement of the shared pool's workers, a dst_placement_e. Takes effect if set before the pool is created.
+void dst_pool_t::set_placement(int placement)
+{
+    dst_pool_t::placement = placement;
+}
+
+int dst_pool_t::get_worker_count() const
+{
+    return worker_count;
+}
+
+int dst_pool_t::get_node_count() const
+{
+    return (int)node_workers.size();
+}
+
+// Queues the task on a worker of the node, or of any node when node < 0
+void dst_pool_t::submit(dst_task_t* task, int node)
+{
+    unsigned int turn = next_worker.fetch_add(1);
+    const std::vector<int>* local = nullptr;
+
+    if (node >= 0 && !node_workers[node % node_workers.size()].empty())
+    {
+        local = &node_workers[node % node_workers.size()];
+    }
+
+    // All queues are only full with more tasks in flight than the pool has queue cells, then wait for the workers
+    while (!push(task, turn, local))
+    {
+        sched_yield();
+    }
+
+    work_seq.add(1, 1);
+}
+
+// Pushes the task to the turn-th worker of the node, passing it on to the next one while a queue is full,
+// and then to the workers of all nodes
+bool dst_pool_t::push(dst_task_t* task, unsigned int turn, const std::vector<int>* local)
+{
+    if (local)
+    {
+        for (size_t i = 0; i < local->size(); i++)
+        {
+            if (workers[(*local)[(turn + i) % local->size()]].tasks.push(task))
+            {
+                return true;
+            }
+        }
+    }
+
+    for (int i = 0; i < worker_count; i++)
+    {
+        if (workers[(turn + i) % worker_count].tasks.push(task))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Takes the oldest task of the worker's own queue, or steals the oldest task of a busy queue of its own node
+// and then of any other node
+dst_task_t* dst_pool_t::take(int worker_nr)
+{
+    const std::vector<int>& local = node_workers[workers[worker_nr].node];
+    int own = 0;
+
+    while (local[own] != worker_nr)
+    {
+        own++;
+    }
+
+    for (size_t i = 0; i < local.size(); i++)
+    {
+        dst_task_t* task = workers[local[(own + i) % local.size()]].tasks.pop();
+
+        if (task)
+        {
+            return task;
+        }
+    }
+
+    for (int i = 1; i < worker_count; i++)
+    {
+        dst_worker_t* worker = &workers[(worker_nr + i) % worker_count];
+
+        if (worker->node == workers[worker_nr].node)
+        {
+            continue;
+        }
+
+        dst_task_t* task = worker->tasks.pop();
+
+        if (task)
+        {
+            return task;
+        }
+    }
+
+    return nullptr;
+}
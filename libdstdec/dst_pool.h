@@ -0,0 +1,191 @@
+/*
+    This file is part of SACD.
+
+    SACD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SACD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef _DST_POOL_H_INCLUDED
+#define _DST_POOL_H_INCLUDED
+
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+#include "dst_sync.h"
+
+#define DST_QUEUE_SIZE 256 // Tasks a worker queue holds, a power of two
+
+enum dst_placement_e {DST_PLACEMENT_NONE, DST_PLACEMENT_NODE, DST_PLACEMENT_CPU};
+
+// The usable CPUs of the process grouped by NUMA node, read from sysfs. Nodes without a usable CPU are left
+// out, so node numbers here are dense and need not match the kernel's. Without sysfs there is one node.
+class dst_topology_t
+{
+    std::vector<std::vector<int>> node_cpus;
+    std::vector<cpu_set_t> node_sets;
+
+public:
+
+    dst_topology_t();
+    static const dst_topology_t& get();
+    int get_node_count() const;
+    int get_node_cpu_count(int node) const;
+    int get_node_cpu(int node, int index) const;
+    const cpu_set_t* get_node_cpus(int node) const;
+    bool bind_thread(pthread_t thread, int node, int index = -1) const;
+};
+
+class dst_task_t
+{
+    public:
+
+        virtual ~dst_task_t() {}
+        virtual void run() = 0;
+};
+
+// Bounded queue that any thread pushes to and any thread pops from, without locks. Every cell carries a
+// sequence number that says whether it is free for the push at head or holds the task for the pop at tail,
+// so a push or a pop is one compare-and-swap of its position. The cells keep head and tail on separate
+// cache lines.
+class dst_task_queue_t
+{
+    struct cell_t
+    {
+        std::atomic<unsigned int> seq; // pos while free for the push at pos, pos + 1 once it holds that task
+        dst_task_t* task;
+    };
+
+    std::atomic<unsigned int> head; // Position of the next push
+    cell_t cells[DST_QUEUE_SIZE];
+    std::atomic<unsigned int> tail; // Position of the next pop
+
+public:
+
+    dst_task_queue_t() : head(0), tail(0)
+    {
+        for (unsigned int i = 0; i < DST_QUEUE_SIZE; i++)
+        {
+            cells[i].seq.store(i, std::memory_order_relaxed);
+            cells[i].task = nullptr;
+        }
+    }
+
+    // Returns false if the queue is full
+    bool push(dst_task_t* task)
+    {
+        unsigned int pos = head.load(std::memory_order_relaxed);
+
+        while (1)
+        {
+            cell_t& cell = cells[pos & (DST_QUEUE_SIZE - 1)];
+            int diff = (int)(cell.seq.load(std::memory_order_acquire) - pos);
+
+            if (diff == 0)
+            {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.task = task;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Returns the oldest task, or nullptr if the queue is empty
+    dst_task_t* pop()
+    {
+        unsigned int pos = tail.load(std::memory_order_relaxed);
+
+        while (1)
+        {
+            cell_t& cell = cells[pos & (DST_QUEUE_SIZE - 1)];
+            int diff = (int)(cell.seq.load(std::memory_order_acquire) - (pos + 1));
+
+            if (diff == 0)
+            {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    dst_task_t* task = cell.task;
+
+                    cell.seq.store(pos + DST_QUEUE_SIZE, std::memory_order_release);
+                    return task;
+                }
+            }
+            else if (diff < 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+class dst_worker_t
+{
+    public:
+
+        pthread_t hThread;
+        dst_task_queue_t tasks; // Pushed by submitters, popped by the owner and by stealing workers
+        bool thread_started;
+        int node; // NUMA node the worker is bound to, 0 without placement
+
+        dst_worker_t()
+        {
+            thread_started = false;
+            node = 0;
+        }
+};
+
+// Fixed set of worker threads shared by all DST streams of the process. Each worker has its own lock-free
+// queue, submitted tasks are dealt round-robin to the queues, and a worker whose queue runs dry steals the
+// oldest task of another one. Only idle workers touch the futex, to park until the next submission. With a placement the workers are spread over the NUMA nodes and bound to
+// them, a task submitted for a node goes to that node's workers and is stolen by its own node first.
+class dst_pool_t
+{
+    dst_worker_t* workers;
+    int worker_count;
+    std::vector<std::vector<int>> node_workers; // Workers of each node
+    std::atomic<unsigned int> next_worker;
+    std::atomic<bool> terminating;
+    dst_futex_t work_seq; // Bumped on every submission, idle workers park on it
+
+    static int placement;
+
+    static void* worker_thread(void* threadarg);
+    bool push(dst_task_t* task, unsigned int turn, const std::vector<int>* local);
+    dst_task_t* take(int worker_nr);
+
+public:
+
+    dst_pool_t(int threads, int placement = DST_PLACEMENT_NONE);
+    ~dst_pool_t();
+    static dst_pool_t* shared(int threads);
+    static void set_placement(int placement);
+    int get_worker_count() const;
+    int get_node_count() const;
+    void submit(dst_task_t* task, int node = -1);
+};
+
+#endif
@@ -0,0 +1,115 @@
+/*
+    This file is part of SACD.
+
+    SACD is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SACD is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SACD.  If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef _DST_SYNC_H_INCLUDED
+#define _DST_SYNC_H_INCLUDED
+
+#include <atomic>
+#include <climits>
+#include <thread>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define DST_SPIN_COUNT 4000 // Polls before a waiter parks, a few microseconds
+
+inline void dst_cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// An int that one thread changes and others wait on. Waiters spin briefly and then park on a futex,
+// so a change the waiter is already polling for costs no system call on either side.
+class dst_futex_t
+{
+    std::atomic<int> value;
+    std::atomic<int> waiters;
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex word must be a plain int");
+
+    static int spin_count()
+    {
+        static const int count = std::thread::hardware_concurrency() > 1 ? DST_SPIN_COUNT : 0;
+
+        return count;
+    }
+
+public:
+
+    dst_futex_t(int v = 0) : value(v), waiters(0)
+    {
+    }
+
+    int load() const
+    {
+        return value.load(std::memory_order_acquire);
+    }
+
+    // Publishes v and wakes parked waiters (writes made before store() are visible to a waiter that sees v)
+    void store(int v)
+    {
+        value.store(v);
+
+        if (waiters.load() > 0)
+        {
+            syscall(SYS_futex, (int*)&value, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+        }
+    }
+
+    // Adds delta and wakes up to count parked waiters
+    void add(int delta, int count = INT_MAX)
+    {
+        value.fetch_add(delta);
+
+        if (waiters.load() > 0)
+        {
+            syscall(SYS_futex, (int*)&value, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+    }
+
+    // Returns the first value for which ready(value) holds
+    template<class Predicate>
+    int wait(Predicate ready)
+    {
+        int v;
+
+        for (int i = 0; i < spin_count(); i++)
+        {
+            if (ready(v = load()))
+            {
+                return v;
+            }
+
+            dst_cpu_relax();
+        }
+
+        waiters.fetch_add(1);
+
+        while (!ready(v = value.load()))
+        {
+            syscall(SYS_futex, (int*)&value, FUTEX_WAIT_PRIVATE, v, nullptr, nullptr, 0);
+        }
+
+        waiters.fetch_sub(1);
+
+        return v;
+    }
+};
+
+#endif
@@ -82,18 +82,33 @@ int CFrameReader::RiceDecode(CStrData& SD, int m)
 {
     int LSBs;
     int Nr;
-    int RLBit;
     int RunLength;
     int Sign;
 
-    // Retrieve run length code
+    // Retrieve run length code: count the zeros up to the terminating one, 32 bits at a time
     RunLength = 0;
 
-    do
+    for (;;)
     {
-        SD.getIntUnsigned(1, RLBit);
-        RunLength += (1 - RLBit);
-    } while (!RLBit);
+        uint32_t Bits = SD.peekBits(32);
+
+        if (Bits != 0)
+        {
+            int Zeros = __builtin_clz(Bits);
+
+            RunLength += Zeros;
+            SD.skipBits(Zeros + 1);
+            break;
+        }
+
+        RunLength += 32;
+        SD.skipBits(32);
+
+        if (SD.eof())
+        {
+            break;
+        }
+    }
 
     // Retrieve least significant bits
     SD.getIntUnsigned(m, LSBs);
@@ -125,7 +140,7 @@ void CFrameReader::readDSDFrame(CStrData& SD, long MaxFrameLen, int NrOfChannels
 }
 
 // Read segmentation data for filters or Ptables
-void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int FrameLen, int MaxNrOfSegs, int MinSegLen, CSegment& S, int& SameSegAllCh)
+int CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int FrameLen, int MaxNrOfSegs, int MinSegLen, CSegment& S, int& SameSegAllCh)
 {
     int ChNr = 0;
     int DefinedBits = 0;
@@ -146,9 +161,7 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
         {
             if (SegNr >= MaxNrOfSegs)
             {
-                printf("ERROR: Too many segments for this channel!");
-
-                return;
+                return DST_ERROR_SEGMENT_COUNT;
             }
 
             if (!ResolRead)
@@ -158,9 +171,7 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
 
                 if ((S.Resolution == 0) || (S.Resolution > FrameLen - MinSegLen / 8))
                 {
-                    printf("ERROR: Invalid segment resolution!");
-
-                    return;
+                    return DST_ERROR_SEGMENT_RESOLUTION;
                 }
 
                 ResolRead = true;
@@ -172,9 +183,7 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
 
             if ((S.Resolution * 8 * S.SegmentLen[0][SegNr] < MinSegLen) || (S.Resolution * 8 * S.SegmentLen[0][SegNr] > FrameLen * 8 - DefinedBits - MinSegLen))
             {
-                printf("ERROR: Invalid segment length!");
-
-                return;
+                return DST_ERROR_SEGMENT_LENGTH;
             }
 
             DefinedBits += S.Resolution * 8 * S.SegmentLen[0][SegNr];
@@ -203,9 +212,7 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
         {
             if (SegNr >= MaxNrOfSegs)
             {
-                printf("ERROR: Too many segments for this channel!");
-
-                return;
+                return DST_ERROR_SEGMENT_COUNT;
             }
 
             SD.getIntUnsigned(1, EndOfChannel);
@@ -219,9 +226,7 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
 
                     if ((S.Resolution == 0) || (S.Resolution > FrameLen - MinSegLen / 8))
                     {
-                        printf("ERROR: Invalid segment resolution!");
-
-                        return;
+                        return DST_ERROR_SEGMENT_RESOLUTION;
                     }
 
                     ResolRead = true;
@@ -232,9 +237,7 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
 
                 if ((S.Resolution * 8 * S.SegmentLen[ChNr][SegNr] < MinSegLen) || (S.Resolution * 8 * S.SegmentLen[ChNr][SegNr] > FrameLen * 8 - DefinedBits - MinSegLen))
                 {
-                    printf("ERROR: Invalid segment length!");
-
-                    return;
+                    return DST_ERROR_SEGMENT_LENGTH;
                 }
 
                 DefinedBits += S.Resolution * 8 * S.SegmentLen[ChNr][SegNr];
@@ -257,10 +260,12 @@ void CFrameReader::readTableSegmentData(CStrData& SD, int NrOfChannels, int Fram
     {
         S.Resolution = 1;
     }
+
+    return DST_NOERROR;
 }
 
 // Copy segmentation data for filters and Ptables
-void CFrameReader::copySegmentData(CFrameHeader& FH)
+int CFrameReader::copySegmentData(CFrameHeader& FH)
 {
     FH.PSeg.Resolution = FH.FSeg.Resolution;
     FH.PSameSegAllCh = 1;
@@ -271,9 +276,7 @@ void CFrameReader::copySegmentData(CFrameHeader& FH)
 
         if (FH.PSeg.NrOfSegments[ChNr] > MAXNROF_PSEGS)
         {
-            printf("ERROR: Too many segments!");
-
-            return;
+            return DST_ERROR_SEGMENT_COUNT;
         }
 
         if (FH.PSeg.NrOfSegments[ChNr] != FH.PSeg.NrOfSegments[0])
@@ -287,9 +290,7 @@ void CFrameReader::copySegmentData(CFrameHeader& FH)
 
             if ((FH.PSeg.SegmentLen[ChNr][SegNr] != 0) &&   (FH.PSeg.Resolution * 8 * FH.PSeg.SegmentLen[ChNr][SegNr] < MIN_PSEG_LEN))
             {
-                printf("ERROR: Invalid segment length!");
-
-                return;
+                return DST_ERROR_SEGMENT_LENGTH;
             }
 
             if (FH.PSeg.SegmentLen[ChNr][SegNr] != FH.PSeg.SegmentLen[0][SegNr])
@@ -298,26 +299,33 @@ void CFrameReader::copySegmentData(CFrameHeader& FH)
             }
         }
     }
+
+    return DST_NOERROR;
 }
 
 // Read segmentation data for filters and Ptables
-void CFrameReader::readSegmentData(CStrData& SD, CFrameHeader& FH)
+int CFrameReader::readSegmentData(CStrData& SD, CFrameHeader& FH)
 {
+    int Error;
+
     SD.getIntUnsigned(1, FH.PSameSegAsF);
-    readTableSegmentData(SD, FH.NrOfChannels, FH.MaxFrameLen, MAXNROF_FSEGS, MIN_FSEG_LEN, FH.FSeg, FH.FSameSegAllCh);
+    Error = readTableSegmentData(SD, FH.NrOfChannels, FH.MaxFrameLen, MAXNROF_FSEGS, MIN_FSEG_LEN, FH.FSeg, FH.FSameSegAllCh);
 
-    if (FH.PSameSegAsF == 1)
+    if (Error != DST_NOERROR)
     {
-        copySegmentData(FH);
+        return Error;
     }
-    else
+
+    if (FH.PSameSegAsF == 1)
     {
-        readTableSegmentData(SD, FH.NrOfChannels, FH.MaxFrameLen, MAXNROF_PSEGS, MIN_PSEG_LEN, FH.PSeg, FH.PSameSegAllCh);
+        return copySegmentData(FH);
     }
+
+    return readTableSegmentData(SD, FH.NrOfChannels, FH.MaxFrameLen, MAXNROF_PSEGS, MIN_PSEG_LEN, FH.PSeg, FH.PSameSegAllCh);
 }
 
 // Read mapping data for filters or Ptables
-void CFrameReader::readTableMappingData(CStrData& SD, int NrOfChannels, int MaxNrOfTables, CSegment& S, int& NrOfTables, int& SameMapAllCh)
+int CFrameReader::readTableMappingData(CStrData& SD, int NrOfChannels, int MaxNrOfTables, CSegment& S, int& NrOfTables, int& SameMapAllCh)
 {
     int CountTables = 1;
     int NrOfBits = 1;
@@ -338,9 +346,7 @@ void CFrameReader::readTableMappingData(CStrData& SD, int NrOfChannels, int MaxN
             }
             else if (S.Table4Segment[0][SegNr] > CountTables)
             {
-                printf("ERROR: Invalid table number for segment!");
-
-                return;
+                return DST_ERROR_TABLE_NUMBER;
             }
         }
 
@@ -348,9 +354,7 @@ void CFrameReader::readTableMappingData(CStrData& SD, int NrOfChannels, int MaxN
         {
             if (S.NrOfSegments[ChNr] != S.NrOfSegments[0])
             {
-                printf("ERROR: Mapping can't be the same for all channels!");
-
-                return;
+                return DST_ERROR_MAPPING;
             }
 
             for (int SegNr = 0; SegNr < S.NrOfSegments[0]; SegNr++)
@@ -376,9 +380,7 @@ void CFrameReader::readTableMappingData(CStrData& SD, int NrOfChannels, int MaxN
                     }
                     else if (S.Table4Segment[ChNr][SegNr] > CountTables)
                     {
-                        printf("ERROR: Invalid table number for segment!");
-
-                        return;
+                        return DST_ERROR_TABLE_NUMBER;
                     }
                 }
             }
@@ -387,16 +389,16 @@ void CFrameReader::readTableMappingData(CStrData& SD, int NrOfChannels, int MaxN
 
     if (CountTables > MaxNrOfTables)
     {
-        printf("ERROR: Too many tables for this frame!");
-
-        return;
+        return DST_ERROR_TABLE_COUNT;
     }
 
     NrOfTables = CountTables;
+
+    return DST_NOERROR;
 }
 
 // Copy mapping data for Ptables from the filter mapping
-void CFrameReader::copyMappingData(CFrameHeader& FH)
+int CFrameReader::copyMappingData(CFrameHeader& FH)
 {
     FH.PSameMapAllCh = 1;
 
@@ -416,9 +418,7 @@ void CFrameReader::copyMappingData(CFrameHeader& FH)
         }
         else
         {
-            printf("ERROR: Not the same number of segments for filters and Ptables!");
-
-            return;
+            return DST_ERROR_MAPPING;
         }
     }
 
@@ -426,35 +426,49 @@ void CFrameReader::copyMappingData(CFrameHeader& FH)
 
     if (FH.NrOfPtables > FH.MaxNrOfPtables)
     {
-        printf("ERROR: Too many tables for this frame!");
-
-        return;
+        return DST_ERROR_TABLE_COUNT;
     }
+
+    return DST_NOERROR;
 }
 
 // Read mapping data (which channel uses which filter/Ptable)
-void CFrameReader::readMappingData(CStrData& SD, CFrameHeader& FH)
+int CFrameReader::readMappingData(CStrData& SD, CFrameHeader& FH)
 {
+    int Error;
+
     SD.getIntUnsigned(1, FH.PSameMapAsF);
-    readTableMappingData(SD, FH.NrOfChannels, FH.MaxNrOfFilters, FH.FSeg, FH.NrOfFilters, FH.FSameMapAllCh);
+    Error = readTableMappingData(SD, FH.NrOfChannels, FH.MaxNrOfFilters, FH.FSeg, FH.NrOfFilters, FH.FSameMapAllCh);
+
+    if (Error != DST_NOERROR)
+    {
+        return Error;
+    }
 
     if (FH.PSameMapAsF == 1)
     {
-        copyMappingData(FH);
+        Error = copyMappingData(FH);
     }
     else
     {
-        readTableMappingData(SD, FH.NrOfChannels, FH.MaxNrOfPtables, FH.PSeg, FH.NrOfPtables, FH.PSameMapAllCh);
+        Error = readTableMappingData(SD, FH.NrOfChannels, FH.MaxNrOfPtables, FH.PSeg, FH.NrOfPtables, FH.PSameMapAllCh);
+    }
+
+    if (Error != DST_NOERROR)
+    {
+        return Error;
     }
 
     for (int i = 0; i < FH.NrOfChannels; i++)
     {
         SD.getIntUnsigned(1, FH.HalfProb[i]);
     }
+
+    return DST_NOERROR;
 }
 
 // Read all filter data from the DST file, which contains: which channel uses which filter, for each filter: prediction order, all coefficients
-void CFrameReader::readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHeader& FH, CCodedTableF& CF)
+int CFrameReader::readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHeader& FH, CCodedTableF& CF)
 {
     // Read the filter parameters
     for (int FilterNr = 0; FilterNr < FH.NrOfFilters; FilterNr++)
@@ -480,9 +494,7 @@ void CFrameReader::readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHead
 
             if (CF.CPredOrder[bestmethod] >= FH.PredOrder[FilterNr])
             {
-                printf("ERROR: Invalid coefficient coding method!");
-
-                return;
+                return DST_ERROR_CODING_METHOD;
             }
 
             for (int CoefNr = 0; CoefNr < CF.CPredOrder[bestmethod]; CoefNr++)
@@ -513,9 +525,7 @@ void CFrameReader::readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHead
 
                 if ((c < -(1 << (SIZE_PREDCOEF - 1))) || (c >= (1 << (SIZE_PREDCOEF - 1))))
                 {
-                    printf("ERROR: filter coefficient out of range!");
-
-                    return;
+                    return DST_ERROR_COEF_RANGE;
                 }
                 else
                 {
@@ -529,10 +539,12 @@ void CFrameReader::readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHead
     {
         FH.NrOfHalfBits[ChNr] = FH.PredOrder[FH.FSeg.Table4Segment[ChNr][0]];
     }
+
+    return DST_NOERROR;
 }
 
 // Read all Ptable data from the DST file, which contains: which channel uses which Ptable, for each Ptable all entries
-void CFrameReader::readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedTableP& CP, int P_one[2 * MAX_CHANNELS][AC_HISMAX])
+int CFrameReader::readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedTableP& CP, int P_one[2 * MAX_CHANNELS][AC_HISMAX])
 {
     // Read the data of all probability tables (table entries)
     for (int PtableNr = 0; PtableNr < FH.NrOfPtables; PtableNr++)
@@ -562,9 +574,7 @@ void CFrameReader::readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedT
 
                 if (CP.CPredOrder[bestmethod] >= FH.PtableLen[PtableNr])
                 {
-                    printf("ERROR: Invalid Ptable coding method!");
-
-                    return;
+                    return DST_ERROR_CODING_METHOD;
                 }
 
                 for (int EntryNr = 0; EntryNr < CP.CPredOrder[bestmethod]; EntryNr++)
@@ -596,9 +606,7 @@ void CFrameReader::readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedT
 
                     if ((c < 1) || (c > (1 << (AC_BITS - 1))))
                     {
-                        printf("ERROR: Ptable entry out of range!");
-
-                        return;
+                        return DST_ERROR_PTABLE_RANGE;
                     }
                     else
                     {
@@ -613,33 +621,6 @@ void CFrameReader::readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedT
             CP.BestMethod[PtableNr] = -1;
         }
     }
-}
-
-// Read arithmetic coded data from the DST file, which contains: length of the arithmetic code, all bits of the arithmetic code
-void CFrameReader::readArithmeticCodedData(CStrData& SD, int ADataLen, ADataByte* AData)
-{
-    for (int j = 0; j < (ADataLen >> 3); j++)
-    {
-        uint8_t v;
-
-        SD.getChrUnsigned(8, v);
-        AData[j] = v;
-    }
-
-    uint8_t Val = 0;
 
-    for (int j = ADataLen & ~7; j < ADataLen; j++)
-    {
-        uint8_t v;
-
-        SD.getChrUnsigned(1, v);
-
-        Val |= v << (7 - (j & 7));
-
-        if (j == ADataLen - 1)
-        {
-            AData[j >> 3] = Val;
-            Val = 0;
-        }
-    }
+    return DST_NOERROR;
 }
@@ -75,15 +75,14 @@ public:
     static int log2RoundUp(long x);
     static int RiceDecode(CStrData& SD, int m);
     static void readDSDFrame(CStrData& SD, long MaxFrameLen, int NrOfChannels, uint8_t* DSDFrame);
-    static void readTableSegmentData(CStrData& SD, int NrOfChannels, int FrameLen, int MaxNrOfSegs, int MinSegLen, CSegment& S, int& SameSegAllCh);
-    static void copySegmentData(CFrameHeader& FH);
-    static void readSegmentData(CStrData& SD, CFrameHeader& FH);
-    static void readTableMappingData(CStrData& SD, int NrOfChannels, int MaxNrOfTables, CSegment& S, int& NrOfTables, int& SameMapAllCh);
-    static void copyMappingData(CFrameHeader& FH);
-    static void readMappingData(CStrData& SD, CFrameHeader& FH);
-    static void readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHeader& FH, CCodedTableF& CF);
-    static void readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedTableP& CP, int P_one[2 * MAX_CHANNELS][AC_HISMAX]);
-    static void readArithmeticCodedData(CStrData& SD, int ADataLen, ADataByte* AData);
+    static int readTableSegmentData(CStrData& SD, int NrOfChannels, int FrameLen, int MaxNrOfSegs, int MinSegLen, CSegment& S, int& SameSegAllCh);
+    static int copySegmentData(CFrameHeader& FH);
+    static int readSegmentData(CStrData& SD, CFrameHeader& FH);
+    static int readTableMappingData(CStrData& SD, int NrOfChannels, int MaxNrOfTables, CSegment& S, int& NrOfTables, int& SameMapAllCh);
+    static int copyMappingData(CFrameHeader& FH);
+    static int readMappingData(CStrData& SD, CFrameHeader& FH);
+    static int readFilterCoefSets(CStrData& SD, int NrOfChannels, CFrameHeader& FH, CCodedTableF& CF);
+    static int readProbabilityTables(CStrData& SD, CFrameHeader& FH, CCodedTableP& CP, int P_one[2 * MAX_CHANNELS][AC_HISMAX]);
 };
 
 
@@ -64,44 +64,33 @@
 
 #include "str_data.h"
 
-void CStrData::getDSTDataPointer(uint8_t** pBuffer)
+void CStrData::getDSTDataPointer(const uint8_t** pBuffer)
 {
     *pBuffer = DSTdata;
 }
 
 void CStrData::resetReadingIndex()
 {
-    BitPosition = 0;
     ByteCounter = 0;
-    DataByte = 0;
-}
-
-void CStrData::createBuffer(int size)
-{
-    if (size > (int)sizeof(DSTdata))
-    {
-        TotalBytes = sizeof(DSTdata);
-    }
-    else
-    {
-        TotalBytes = size;
-    }
+    BitCache = 0;
+    BitCount = 0;
 }
 
 void CStrData::deleteBuffer()
 {
+    DSTdata = NULL;
     TotalBytes = 0;
     resetReadingIndex();
 }
 
-void CStrData::fillBuffer(uint8_t* pBuf, int size)
+// Read from the caller's frame buffer in place, it must stay valid while the frame is being read
+void CStrData::setBuffer(const uint8_t* pBuf, int size)
 {
-    createBuffer(size);
-    dst_memcpy(DSTdata, pBuf, TotalBytes);
+    DSTdata = pBuf;
+    TotalBytes = size;
     resetReadingIndex();
 }
 
-
 // function : Read a character as an unsigned number from file with a given number of bits.
 // pre : Len, x, output file must be open by having used getbits_init
 // post : The second variable in function call is filled with the unsigned character read
@@ -115,13 +104,10 @@ void CStrData::getChrUnsigned(int length, uint8_t& x)
 
         x = (unsigned char)tmp;
     }
-    else if (length == 0)
-    {
-        x = 0;
-    }
     else
     {
-        printf("ERROR: a negative number of bits allocated");
+        // A length of zero (or a negative length) reads nothing
+        x = 0;
     }
 }
 
@@ -138,13 +124,10 @@ void CStrData::getIntUnsigned(int length, int& x)
 
         x = (int)tmp;
     }
-    else if (length == 0)
-    {
-        x = 0;
-    }
     else
     {
-        printf("ERROR: a negative number of bits allocated");
+        // A length of zero (or a negative length) reads nothing
+        x = 0;
     }
 }
 
@@ -166,13 +149,10 @@ void CStrData::getIntSigned(int length, int& x)
             x -= (1 << length);
         }
     }
-    else if (length == 0)
-    {
-        x = 0;
-    }
     else
     {
-        printf("ERROR: a negative number of bits allocated");
+        // A length of zero (or a negative length) reads nothing
+        x = 0;
     }
 }
 
@@ -194,13 +174,10 @@ void CStrData::getShortSigned(int length, short& x)
             x -= (1 << length);
         }
     }
-    else if (length == 0)
-    {
-        x = 0;
-    }
     else
     {
-        printf("ERROR: a negative number of bits allocated");
+        // A length of zero (or a negative length) reads nothing
+        x = 0;
     }
 }
 
@@ -209,7 +186,7 @@ void CStrData::getShortSigned(int length, short& x)
 // post: Returns the number of bits written after an init_bitcount.
 int CStrData::get_in_bitcount()
 {
-    return ByteCounter * 8 - BitPosition;
+    return ByteCounter * 8 - BitCount;
 }
 
 // function : Read bits from the bitstream and decrement the counter.
@@ -217,65 +194,7 @@ int CStrData::get_in_bitcount()
 // post: m_ByteCounter, outword, returns EOF on EOF or 0 otherwise.
 int CStrData::getbits(long& outword, int out_bitptr)
 {
-    const int masks[] = { 0, 1, 3, 7, 0xf, 0x1f, 0x3f, 0x7f, 0xff };
-
-    if (out_bitptr == 1)
-    {
-        if (BitPosition == 0)
-        {
-            DataByte = DSTdata[ByteCounter++];
-
-            if (ByteCounter > TotalBytes)
-            {
-                // EOF
-                return -1;
-            }
-
-            BitPosition = 8;
-        }
-
-        BitPosition--;
-        outword = (DataByte >> BitPosition) & 1;
-
-        return 0;
-    }
-
-    outword = 0;
-
-    while (out_bitptr > 0)
-    {
-        int thisbits, mask, shift;
-
-        if (!BitPosition)
-        {
-            DataByte = DSTdata[ByteCounter++];
-
-            if (ByteCounter > TotalBytes)
-            {
-                // EOF
-                return -1;
-            }
-
-            BitPosition = 8;
-        }
-
-        thisbits = MIN(BitPosition, out_bitptr);
-        shift = (BitPosition - thisbits);
-        mask = masks[thisbits] << shift;
-        shift = (out_bitptr - thisbits) - shift;
-
-        if (shift <= 0)
-        {
-            outword |= ((DataByte & mask) >> -shift);
-        }
-        else
-        {
-            outword |= ((DataByte & mask) << shift);
-        }
-
-        out_bitptr -= thisbits;
-        BitPosition -= thisbits;
-    }
+    outword = readBits(out_bitptr);
 
-    return 0;
+    return eof() ? -1 : 0;
 }
@@ -70,28 +70,86 @@
 
 class CStrData
 {
-    uint8_t DSTdata[MAX_CHANNELS * MAX_DSDBYTES_INFRAME];
+    const uint8_t* DSTdata; // DST frame being read, owned by the caller
     int TotalBytes;
-    int ByteCounter;
-    int BitPosition;
-    uint8_t DataByte;
+    int ByteCounter; // Next byte of DSTdata to load into BitCache
+    uint64_t BitCache; // Bits following the reading position, MSB aligned
+    int BitCount; // Number of valid bits in BitCache
+
+    void refill();
 
 public:
 
-    void getDSTDataPointer(uint8_t** pBuffer);
+    void getDSTDataPointer(const uint8_t** pBuffer);
     void resetReadingIndex();
-    void createBuffer(int size);
     void deleteBuffer();
-    void fillBuffer(uint8_t* pBuf, int size);
+    void setBuffer(const uint8_t* pBuf, int size);
     void getChrUnsigned(int length, uint8_t& x);
     void getIntUnsigned(int length, int& x);
     void getIntSigned(int length, int& x);
     void getShortSigned(int length, short& x);
     int get_in_bitcount();
+    bool eof();
+    uint32_t peekBits(int length);
+    void skipBits(int length);
+    uint32_t readBits(int length);
 
 private:
 
     int getbits(long& outword, int out_bitptr);
 };
 
+// Load whole bytes into BitCache until it holds at least 57 bits; bytes past the end of the frame read as zero
+inline void CStrData::refill()
+{
+    while (BitCount <= 56)
+    {
+        uint64_t v = (ByteCounter < TotalBytes) ? DSTdata[ByteCounter] : 0;
+
+        BitCache |= v << (56 - BitCount);
+        BitCount += 8;
+        ByteCounter++;
+    }
+}
+
+// Returns true once bits past the end of the frame have been read
+inline bool CStrData::eof()
+{
+    return get_in_bitcount() > TotalBytes * 8;
+}
+
+// Returns the next length (1..32) bits without consuming them
+inline uint32_t CStrData::peekBits(int length)
+{
+    if (BitCount < length)
+    {
+        refill();
+    }
+
+    return (uint32_t)(BitCache >> (64 - length));
+}
+
+// Consumes length (0..32) bits
+inline void CStrData::skipBits(int length)
+{
+    if (BitCount < length)
+    {
+        refill();
+    }
+
+    BitCache <<= length;
+    BitCount -= length;
+}
+
+// Reads length (1..32) bits as an unsigned number
+inline uint32_t CStrData::readBits(int length)
+{
+    uint32_t x = peekBits(length);
+
+    BitCache <<= length;
+    BitCount -= length;
+
+    return x;
+}
+
 #endif
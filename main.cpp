@@ -46,7 +46,11 @@ struct TrackInfo
 };
 
 int g_nCPUs = 2;
+int g_nDstFrames = 8; // DST frames read ahead of the one being converted, 4 per CPU
 int g_nThreads = 2;
+int g_nPlacement = DST_PLACEMENT_NONE; // Thread placement on the NUMA nodes and CPUs, a dst_placement_e
+bool g_bConvFp64 = true; // Double precision DSD to PCM filters, single precision for quick transcodes
+int g_nConvType = DSDPCM_CONV_MULTISTAGE; // DSD to PCM filter chain, a conv_type_e
 vector<TrackInfo> g_arrQueue;
 pthread_mutex_t g_hMutex = PTHREAD_MUTEX_INITIALIZER;
 string g_strOut = "";
@@ -56,6 +60,18 @@ bool g_bProgressLine = false;
 int g_nFinished = 0;
 area_id_e g_nArea = AREA_MULCH;
 
+void fnDstError(void* /* pContext */, const CDSTResult& cResult)
+{
+    if (g_bProgressLine)
+    {
+        fprintf(stderr, "WARNING\tDST\t%d\t%s\t%s\n", cResult.FrameNr, CDSTDecoder::stageText(cResult.Stage), CDSTDecoder::errorText(cResult.Error));
+    }
+    else
+    {
+        fprintf(stderr, "\rWARNING: DST frame %d failed in %s: %s\n", cResult.FrameNr, CDSTDecoder::stageText(cResult.Stage), CDSTDecoder::errorText(cResult.Error));
+    }
+}
+
 void packageInt(unsigned char * buf, int offset, int num, int bytes)
 {
     buf[offset + 0] = (unsigned char)(num & 0xff);
@@ -89,7 +105,8 @@ private:
     dst_decoder_t* m_pDstDecoder;
     vector<uint8_t> m_arrDstBuf;
     vector<uint8_t> m_arrDsdBuf;
-    vector<float> m_arrPcmBuf;
+    vector<uint8_t> m_arrPcmBuf; // Interleaved float samples, or packed 24-bit ones from the 44.1kHz engine
+    int m_nPcmFrameSize; // Bytes per sample of all channels in m_arrPcmBuf
     int m_nDsdBufSize;
     int m_nDstBufSize;
     dsdpcm_converter_hq* m_pDsdPcmConverter480;
@@ -98,13 +115,15 @@ private:
     int m_nFramerate;
     int m_nPcmOutSamples;
     int m_nPcmOutDelta;
+    int m_nNode;
+    int m_nNodeSlot;
 
-    void dsd2pcm(uint8_t* dsd_data, int dsd_samples, float* pcm_data)
+    void dsd2pcm(uint8_t* dsd_data, int dsd_samples, uint8_t* pcm_data)
     {
 
         if (m_pDsdPcmConverter480)
         {
-            m_pDsdPcmConverter480->convert(dsd_data, dsd_samples, pcm_data);
+            m_pDsdPcmConverter480->convert(dsd_data, dsd_samples, (float*)pcm_data);
         }
         else if (m_pDsdPcmConverter441)
         {
@@ -114,9 +133,18 @@ private:
 
     void writeData(FILE * pFile, int nOffset, int nSamples)
     {
+        // The 44.1kHz engine writes the 24-bit samples itself
+        if (!m_pDsdPcmConverter480)
+        {
+            fwrite(m_arrPcmBuf.data() + nOffset * m_nPcmFrameSize, 1, nSamples * m_nPcmFrameSize, pFile);
+            m_fProgress = m_pSacdReader->getProgress();
+
+            return;
+        }
+
         int nFramesIn = nSamples * m_nPcmOutChannels;
         int nBytesOut = nFramesIn * 3;
-        char * pSrc = (char*)(m_arrPcmBuf.data() + nOffset * m_nPcmOutChannels);
+        char * pSrc = (char*)(m_arrPcmBuf.data() + nOffset * m_nPcmFrameSize);
         char * pDst = new char[nBytesOut];
         float fSample;
         int32_t nVal;
@@ -205,6 +233,9 @@ public:
         m_nTracks = 0;
         m_nPcmOutSamples = 0;
         m_nPcmOutDelta = 0;
+        m_nPcmFrameSize = 0;
+        m_nNode = -1;
+        m_nNodeSlot = 0;
     }
 
     ~SACD()
@@ -234,6 +265,21 @@ public:
         }
     }
 
+    // Keeps the track thread's work on the node: its buffers, DST frames and converter channels
+    void setNode(int nNode, int nNodeSlot)
+    {
+        m_nNode = nNode;
+        m_nNodeSlot = nNodeSlot;
+    }
+
+    void bindThread()
+    {
+        if (m_nNode >= 0)
+        {
+            dst_topology_t::get().bind_thread(pthread_self(), m_nNode);
+        }
+    }
+
     int open(string p_path)
     {
         string ext = toLower(p_path.substr(p_path.length()-3, 3));
@@ -319,12 +365,8 @@ public:
 
     string init(uint32_t nSubsong, int g_nSampleRate, area_id_e nArea)
     {
-        if (m_pDsdPcmConverter441)
-        {
-            delete m_pDsdPcmConverter441;
-            m_pDsdPcmConverter441 = nullptr;
-        }
-        else if (m_pDsdPcmConverter480)
+        // The 44.1kHz engine is kept for the next track, its init() reuses the threads when the format matches
+        if (m_pDsdPcmConverter480)
         {
             delete m_pDsdPcmConverter480;
             m_pDsdPcmConverter480 = nullptr;
@@ -368,9 +410,9 @@ public:
         }
 
         m_nDstBufSize = m_nDsdBufSize = m_nDsdSamplerate / 8 / m_nFramerate * m_nPcmOutChannels;
-        m_arrDsdBuf.resize(m_nDsdBufSize * g_nCPUs);
-        m_arrDstBuf.resize(m_nDstBufSize * g_nCPUs);
-        m_arrPcmBuf.resize(m_nPcmOutChannels * m_nPcmOutSamples);
+        m_arrDsdBuf.resize(m_nDsdBufSize * g_nDstFrames);
+        m_arrDstBuf.resize(m_nDstBufSize * g_nDstFrames);
+        m_arrPcmBuf.resize(m_nPcmOutChannels * m_nPcmOutSamples * sizeof(float));
 
         if (g_nSampleRate == 96000 or g_nSampleRate == 192000)
         {
@@ -379,10 +421,34 @@ public:
         }
         else
         {
-            m_pDsdPcmConverter441 = new DSDPCMConverterEngine();
-            m_pDsdPcmConverter441->init(m_nPcmOutChannels, m_nFramerate, m_nDsdSamplerate, g_nSampleRate);
+            if (!m_pDsdPcmConverter441)
+            {
+                m_pDsdPcmConverter441 = new DSDPCMConverterEngine();
+            }
+
+            if (m_nNode >= 0)
+            {
+                const dst_topology_t& cTopology = dst_topology_t::get();
+                vector<cpu_set_t> arrCpus(g_nPlacement == DST_PLACEMENT_CPU ? m_nPcmOutChannels : 1, *cTopology.get_node_cpus(m_nNode));
+
+                if (g_nPlacement == DST_PLACEMENT_CPU)
+                {
+                    for (int ch = 0; ch < m_nPcmOutChannels; ch++)
+                    {
+                        CPU_ZERO(&arrCpus[ch]);
+                        CPU_SET(cTopology.get_node_cpu(m_nNode, m_nNodeSlot * m_nPcmOutChannels + ch), &arrCpus[ch]);
+                    }
+                }
+
+                m_pDsdPcmConverter441->set_affinity(arrCpus.data(), arrCpus.size());
+            }
+
+            m_pDsdPcmConverter441->set_pcm_format(PCM_FORMAT_INT24);
+            m_pDsdPcmConverter441->init(m_nPcmOutChannels, m_nFramerate, m_nDsdSamplerate, g_nSampleRate, g_bConvFp64, g_nConvType);
         }
 
+        m_nPcmFrameSize = m_nPcmOutChannels * (m_pDsdPcmConverter480 ? sizeof(float) : m_pDsdPcmConverter441->get_pcm_sample_size());
+
         float fPcmOutDelay = 0.0f;
 
         if (m_pDsdPcmConverter480)
@@ -406,26 +472,20 @@ public:
         return strFileName;
     }
 
-    void fixPcmStream(bool bIsEnd, float* pPcmData, int nPcmSamples)
+    void fixPcmStream(bool bIsEnd, uint8_t* pPcmData, int nPcmSamples)
     {
         if (!bIsEnd)
         {
             if (nPcmSamples > 1)
             {
-                for (int ch = 0; ch < m_nPcmOutChannels; ch++)
-                {
-                    pPcmData[0 * m_nPcmOutChannels + ch] = pPcmData[1 * m_nPcmOutChannels + ch];
-                }
+                memcpy(pPcmData + 0 * m_nPcmFrameSize, pPcmData + 1 * m_nPcmFrameSize, m_nPcmFrameSize);
             }
         }
         else
         {
             if (nPcmSamples > 1)
             {
-                for (int ch = 0; ch < m_nPcmOutChannels; ch++)
-                {
-                    pPcmData[(nPcmSamples - 1) * m_nPcmOutChannels + ch] = pPcmData[(nPcmSamples - 2) * m_nPcmOutChannels + ch];
-                }
+                memcpy(pPcmData + (nPcmSamples - 1) * m_nPcmFrameSize, pPcmData + (nPcmSamples - 2) * m_nPcmFrameSize, m_nPcmFrameSize);
             }
         }
     }
@@ -465,12 +525,15 @@ public:
                     {
                         if (!m_pDstDecoder)
                         {
-                            m_pDstDecoder = new dst_decoder_t(g_nCPUs);
+                            m_pDstDecoder = new dst_decoder_t(g_nCPUs, g_nDstFrames);
 
                             if (!m_pDstDecoder || m_pDstDecoder->init(m_nPcmOutChannels, m_nDsdSamplerate, m_nFramerate) != 0)
                             {
                                 return true;
                             }
+
+                            m_pDstDecoder->set_logger(fnDstError, NULL);
+                            m_pDstDecoder->set_node(m_nNode);
                         }
 
                         m_pDstDecoder->decode(pDstData, nDstSize, &pDsdData, &nDsdSize);
@@ -494,7 +557,7 @@ public:
 
                         if (nRemoveSamples > 0)
                         {
-                            fixPcmStream(false, m_arrPcmBuf.data() + m_nPcmOutChannels * nRemoveSamples, m_nPcmOutSamples - nRemoveSamples);
+                            fixPcmStream(false, m_arrPcmBuf.data() + m_nPcmFrameSize * nRemoveSamples, m_nPcmOutSamples - nRemoveSamples);
                         }
 
                         writeData(pFile, nRemoveSamples, m_nPcmOutSamples - nRemoveSamples);
@@ -581,6 +644,8 @@ void * fnDecoder (void* threadargs)
 {
     SACD* pSACD = (SACD*)threadargs;
 
+    pSACD->bindThread();
+
     while(!g_arrQueue.empty())
     {
         pthread_mutex_lock(&g_hMutex);
@@ -660,6 +725,8 @@ int main(int argc, char* argv[])
         g_nCPUs = nCPUs;
     }
 
+    g_nDstFrames = 4 * g_nCPUs;
+
     string strIn = "";
     char strPath[PATH_MAX];
     int nOpt;
@@ -684,6 +751,20 @@ int main(int argc, char* argv[])
     "                         to parse the output through a script. This option only\n"
     "                         lists either one progress percentage per line, or one\n"
     "                         status/error message.\n"
+    "  -a, --affinity       : Thread placement: none, node or cpu. With node, each\n"
+    "                         track runs on one NUMA node: its DST decoding, its\n"
+    "                         conversion threads and its buffers. With cpu, the\n"
+    "                         threads are also pinned to single CPUs of the node.\n"
+    "                         If you omit this, the threads are not placed.\n"
+    "  -f, --fp32           : Convert with single precision filters (88200 and\n"
+    "                         176400 only). Faster, for previews and proxies: the\n"
+    "                         difference to the default double precision is\n"
+    "                         some 135 dB below the signal, a few 24-bit steps.\n"
+    "  -m, --mode           : DSD to PCM filtering: multistage or direct. Direct\n"
+    "                         filters in one stage and cuts off at about 20KHz\n"
+    "                         (40KHz from DSD128). It is slower and only applies\n"
+    "                         when the DSD rate is at most 32 times the output\n"
+    "                         rate. If you omit this, multistage will be used.\n"
     "  -d, --details        : Show detailed information about the input\n"
     "  -h, --help           : Show this help message\n\n";
 
@@ -695,12 +776,15 @@ int main(int argc, char* argv[])
         {"rate", required_argument, NULL, 'r' },
         {"stereo", no_argument, NULL, 's'},
         {"progress", no_argument, NULL, 'p'},
+        {"affinity", required_argument, NULL, 'a'},
+        {"fp32", no_argument, NULL, 'f'},
+        {"mode", required_argument, NULL, 'm'},
         {"details", no_argument, NULL, 'd'},
         {"help", no_argument, NULL, 'h' },
         { NULL, 0, NULL, 0 }
     };
 
-    while ((nOpt = getopt_long(argc, argv, "i:o:cr:spdh", tOptionsTable, NULL)) >= 0)
+    while ((nOpt = getopt_long(argc, argv, "i:o:cr:spa:fm:dh", tOptionsTable, NULL)) >= 0)
     {
         switch (nOpt)
         {
@@ -734,6 +818,51 @@ int main(int argc, char* argv[])
             case 'p':
                 g_bProgressLine = true;
                 break;
+            case 'a':
+            {
+                string s = optarg;
+
+                if (s == "none")
+                {
+                    g_nPlacement = DST_PLACEMENT_NONE;
+                }
+                else if (s == "node")
+                {
+                    g_nPlacement = DST_PLACEMENT_NODE;
+                }
+                else if (s == "cpu")
+                {
+                    g_nPlacement = DST_PLACEMENT_CPU;
+                }
+                else
+                {
+                    fprintf(stderr, "PANIC: Invalid affinity\n");
+                    return 0;
+                }
+                break;
+            }
+            case 'f':
+                g_bConvFp64 = false;
+                break;
+            case 'm':
+            {
+                string s = optarg;
+
+                if (s == "multistage")
+                {
+                    g_nConvType = DSDPCM_CONV_MULTISTAGE;
+                }
+                else if (s == "direct")
+                {
+                    g_nConvType = DSDPCM_CONV_DIRECT;
+                }
+                else
+                {
+                    fprintf(stderr, "PANIC: Invalid mode\n");
+                    return 0;
+                }
+                break;
+            }
             case 'd':
                 bPrintDetails = true;
                 break;
@@ -906,10 +1035,21 @@ int main(int argc, char* argv[])
     vector<SACD*> arrSACD(g_nThreads);
     vector<pthread_t> arrThreads(g_nThreads);
 
+    // The shared DST pool is created by the first track that needs it, with this placement
+    dst_pool_t::set_placement(g_nPlacement);
+
+    int nNodes = dst_topology_t::get().get_node_count();
+
     for (int i = 0; i < g_nThreads; i++)
     {
         arrSACD[i] = new SACD();
         arrSACD[i]->open(strIn);
+
+        if (g_nPlacement != DST_PLACEMENT_NONE)
+        {
+            arrSACD[i]->setNode(i % nNodes, i / nNodes);
+        }
+
         pthread_create(&arrThreads[i], NULL, fnDecoder, arrSACD[i]);
         pthread_detach(arrThreads[i]);
     }